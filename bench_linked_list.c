@@ -0,0 +1,395 @@
+#include "linked_list.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "common_defs.h"
+#include "perf_counters.h"
+#include "gitdata.h"
+
+// Returns a monotonic timestamp in seconds.
+static double now_seconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Builds a list of count nodes where every node is inserted after a randomly chosen
+// existing node, so traversal order and address order are unrelated.
+static void build_fragmented_list(Node **head, int count)
+{
+    Node **nodes = malloc(sizeof(Node *) * count);
+    list_insert(head, 0);
+    nodes[0] = *head;
+    for (int i = 1; i < count; i++)
+    {
+        Node *prev = nodes[rand() % i];
+        list_insert_after(prev, (uint16_t)i);
+        nodes[i] = prev->next;
+    }
+    free(nodes);
+}
+
+// Times rounds full traversals of the list and returns the nanoseconds per node; the
+// counters are reported per node of a traversal of the kind described by operation.
+static double time_traversal(Node **head, int count, int rounds, const char *operation)
+{
+    PerfScope perf = perf_begin();
+    double start = now_seconds();
+    long total = 0;
+    for (int r = 0; r < rounds; r++)
+    {
+        total += list_count_nodes(head);
+    }
+    double elapsed = now_seconds() - start;
+    perf_end(&perf, operation, (double)count * rounds);
+    my_assert(total == (long)count * rounds);
+    return elapsed * 1e9 / ((double)count * rounds);
+}
+
+// ********* Benchmarks *********
+
+void bench_list_compact(int count)
+{
+    printf_yellow("  Benchmarking traversal before and after list_compact (%d nodes)\n", count);
+    Node *head = NULL;
+    list_init(&head, sizeof(Node) * (size_t)count * 3);
+    build_fragmented_list(&head, count);
+
+    double before = time_traversal(&head, count, 10, "node of a fragmented traversal");
+
+    PerfScope perf = perf_begin();
+    double start = now_seconds();
+    my_assert(list_compact(&head) == 0);
+    double compact = now_seconds() - start;
+    perf_end(&perf, "node compacted", count);
+
+    double after = time_traversal(&head, count, 10, "node of a compacted traversal");
+
+    printf("\tfragmented traversal: %.2f ns/node\n", before);
+    printf("\tlist_compact:         %.2f ms\n", compact * 1e3);
+    printf("\tcompacted traversal:  %.2f ns/node (%.1fx)\n", after, before / after);
+
+    list_cleanup(&head);
+}
+
+void bench_list_display(int count)
+{
+    printf_yellow("  Benchmarking list serialization (%d nodes)\n", count);
+    Node *head = NULL;
+    list_init(&head, sizeof(Node) * (size_t)count);
+    Node *tail = NULL;
+    for (int i = 0; i < count; i++)
+    {
+        if (tail == NULL)
+        {
+            list_insert(&head, (uint16_t)rand());
+            tail = head;
+        }
+        else
+        {
+            list_insert_after(tail, (uint16_t)rand());
+            tail = tail->next;
+        }
+    }
+
+    size_t size = list_to_string(&head, NULL, 0) + 1;
+    char *buffer = malloc(size);
+    PerfScope perf = perf_begin();
+    double start = now_seconds();
+    my_assert(list_to_string(&head, buffer, size) == size - 1);
+    double to_string = now_seconds() - start;
+    perf_end(&perf, "node of list_to_string", count);
+
+    FILE *sink = fopen("/dev/null", "w");
+    my_assert(sink != NULL);
+    perf = perf_begin();
+    start = now_seconds();
+    list_fprint_range(sink, &head, NULL, NULL);
+    fflush(sink);
+    double fprint = now_seconds() - start;
+    perf_end(&perf, "node of list_fprint_range", count);
+    fclose(sink);
+
+    printf("\tlist_to_string:    %.2f ms (%.0f MB/s)\n", to_string * 1e3, size / to_string / 1e6);
+    printf("\tlist_fprint_range: %.2f ms (%.0f MB/s)\n", fprint * 1e3, size / fprint / 1e6);
+
+    free(buffer);
+    list_cleanup(&head);
+}
+
+void bench_list_save_load(int count)
+{
+    printf_yellow("  Benchmarking list_save and list_load (%d nodes)\n", count);
+    Node *head = NULL;
+    list_init(&head, sizeof(Node) * (size_t)count * 2);
+    list_insert(&head, 0);
+    Node *tail = head;
+    for (int i = 1; i < count; i++)
+    {
+        list_insert_after(tail, (uint16_t)i);
+        tail = tail->next;
+    }
+
+    char path[] = "/tmp/bench_list_XXXXXX";
+    int fd = mkstemp(path);
+    my_assert(fd >= 0);
+    unlink(path);
+
+    PerfScope perf = perf_begin();
+    double start = now_seconds();
+    my_assert(list_save(&head, fd) == 0);
+    double save = now_seconds() - start;
+    perf_end(&perf, "node saved", count);
+    list_cleanup(&head);
+
+    list_init(&head, sizeof(Node) * (size_t)count);
+    perf = perf_begin();
+    start = now_seconds();
+    my_assert(list_load(&head, fd) == count);
+    double load = now_seconds() - start;
+    perf_end(&perf, "node loaded", count);
+    my_assert(list_count_nodes(&head) == count);
+
+    printf("\tlist_save: %.2f ms\n", save * 1e3);
+    printf("\tlist_load: %.2f ms (%.2f ns/node)\n", load * 1e3, load * 1e9 / count);
+
+    close(fd);
+    list_cleanup(&head);
+}
+
+void bench_skiplist(int count)
+{
+    printf_yellow("  Benchmarking sorted workload with and without skip list (%d nodes)\n", count);
+    SkipList list;
+    skiplist_init(&list, (sizeof(Node) + sizeof(SkipIndex)) * (size_t)count * 2);
+
+    PerfScope perf = perf_begin();
+    double start = now_seconds();
+    for (int i = 0; i < count; i++)
+    {
+        skiplist_insert(&list, (uint16_t)rand());
+    }
+    double insert = (now_seconds() - start) / count;
+    perf_end(&perf, "skiplist_insert", count);
+
+    long found = 0;
+    perf = perf_begin();
+    start = now_seconds();
+    for (int i = 0; i < count; i++)
+    {
+        found += skiplist_search(&list, (uint16_t)rand()) != NULL;
+    }
+    double search = (now_seconds() - start) / count;
+    perf_end(&perf, "skiplist_search", count);
+
+    // The plain list operations are O(n), so time a sample and report per operation.
+    int sample = 200;
+    perf = perf_begin();
+    start = now_seconds();
+    for (int i = 0; i < sample; i++)
+    {
+        found += list_search(&list.head, (uint16_t)rand()) != NULL;
+    }
+    double linear_search = (now_seconds() - start) / sample;
+    perf_end(&perf, "list_search", sample);
+
+    perf = perf_begin();
+    start = now_seconds();
+    for (int i = 0; i < sample; i++)
+    {
+        list_insert_sorted(&list.head, (uint16_t)rand());
+    }
+    double linear_insert = (now_seconds() - start) / sample;
+    perf_end(&perf, "list_insert_sorted", sample);
+
+    printf("\tskiplist_insert:    %10.1f ns/op\n", insert * 1e9);
+    printf("\tlist_insert_sorted: %10.1f ns/op (%.0fx slower)\n", linear_insert * 1e9, linear_insert / insert);
+    printf("\tskiplist_search:    %10.1f ns/op\n", search * 1e9);
+    printf("\tlist_search:        %10.1f ns/op (%.0fx slower, %ld hits)\n", linear_search * 1e9, linear_search / search, found);
+
+    skiplist_cleanup(&list);
+}
+
+void bench_list_parallel(int count)
+{
+    printf_yellow("  Benchmarking parallel reduce and find-all (%d nodes)\n", count);
+    Node *head = NULL;
+    list_init(&head, sizeof(Node) * (size_t)count);
+    list_insert(&head, (uint16_t)rand());
+    Node *tail = head;
+    for (int i = 1; i < count; i++)
+    {
+        list_insert_after(tail, (uint16_t)rand());
+        tail = tail->next;
+    }
+
+    double start = now_seconds();
+    ListSample sample;
+    my_assert(list_sample(&head, 16384, &sample) == 0);
+    printf("\tlist_sample: %.2f ms (%zu segments)\n", (now_seconds() - start) * 1e3, sample.segments);
+
+    start = now_seconds();
+    int sequential = list_count_nodes(&head);
+    printf("\tlist_count_nodes: %.2f ms\n", (now_seconds() - start) * 1e3);
+    my_assert(sequential == count);
+
+    ListStats reference = list_parallel_reduce(&sample, 1);
+    double base = 0;
+    for (int threads = 1; threads <= 16; threads *= 2)
+    {
+        char operation[64];
+        snprintf(operation, sizeof(operation), "node reduced on %d threads", threads);
+        PerfScope perf = perf_begin();
+        start = now_seconds();
+        ListStats stats = list_parallel_reduce(&sample, threads);
+        double reduce = now_seconds() - start;
+        perf_end(&perf, operation, count);
+        my_assert(stats.sum == reference.sum && stats.count == (size_t)count);
+
+        snprintf(operation, sizeof(operation), "node searched on %d threads", threads);
+        perf = perf_begin();
+        start = now_seconds();
+        list_parallel_find_all(&sample, threads, 42, NULL, 0);
+        double find = now_seconds() - start;
+        perf_end(&perf, operation, count);
+
+        if (threads == 1)
+        {
+            base = reduce;
+        }
+        printf("\t%2d threads: reduce %.2f ms (%.2fx), find-all %.2f ms\n", threads, reduce * 1e3, base / reduce, find * 1e3);
+    }
+
+    list_sample_free(&sample);
+    list_cleanup(&head);
+}
+
+// Arguments of one thread of bench_concurrent_list.
+typedef struct ConcurrentArgs
+{
+    ConcurrentList *list;
+    unsigned seed;
+    int operations;
+} ConcurrentArgs;
+
+// Runs a read-mostly mix: 80% contains, 10% insert, 10% delete.
+static void *concurrent_list_worker(void *arg)
+{
+    ConcurrentArgs *args = (ConcurrentArgs *)arg;
+    for (int i = 0; i < args->operations; i++)
+    {
+        uint16_t value = (uint16_t)(rand_r(&args->seed) % 2048);
+        int op = rand_r(&args->seed) % 10;
+        if (op == 0)
+        {
+            concurrent_list_insert(args->list, value);
+        }
+        else if (op == 1)
+        {
+            concurrent_list_delete(args->list, value);
+        }
+        else
+        {
+            concurrent_list_contains(args->list, value);
+        }
+    }
+    return NULL;
+}
+
+void bench_concurrent_list(int operations)
+{
+    printf_yellow("  Benchmarking concurrent list throughput (%d operations per thread)\n", operations);
+    for (int threads = 1; threads <= 16; threads *= 2)
+    {
+        ConcurrentList list;
+        concurrent_list_init(&list, sizeof(LockedNode) * ((size_t)operations * threads + 1024));
+        for (int i = 0; i < 1024; i++)
+        {
+            concurrent_list_insert(&list, (uint16_t)(rand() % 2048));
+        }
+
+        pthread_t workers[16];
+        ConcurrentArgs args[16];
+        char operation[64];
+        snprintf(operation, sizeof(operation), "operation on %d threads", threads);
+        PerfScope perf = perf_begin();
+        double start = now_seconds();
+        for (int t = 0; t < threads; t++)
+        {
+            args[t] = (ConcurrentArgs){&list, (unsigned)t + 1, operations};
+            my_assert(pthread_create(&workers[t], NULL, concurrent_list_worker, &args[t]) == 0);
+        }
+        for (int t = 0; t < threads; t++)
+        {
+            pthread_join(workers[t], NULL);
+        }
+        double elapsed = now_seconds() - start;
+        perf_end(&perf, operation, (double)operations * threads);
+
+        printf("\t%2d threads: %.0f ops/s\n", threads, (double)operations * threads / elapsed);
+        concurrent_list_cleanup(&list);
+    }
+}
+
+// Main function to run the benchmarks
+int main(int argc, char *argv[])
+{
+    srand(12345);
+#ifdef VERSION
+    printf("Build Version; %s \n", VERSION);
+#endif
+    printf("Git Version; %s/%s \n", git_date, git_sha);
+    if (argc < 2)
+    {
+        printf("Usage: %s <benchmark>\n", argv[0]);
+        printf("Available benchmarks:\n");
+        printf(" 1. bench_list_compact - Traversal of a fragmented 1M-node list before and after compaction\n");
+        printf(" 2. bench_list_display - Serialization throughput of a 1M-node list\n");
+        printf(" 3. bench_list_save_load - Binary save and mmap load of a 10M-node list\n");
+        printf(" 4. bench_skiplist - Sorted 1M-element workload with and without the skip list\n");
+        printf(" 5. bench_list_parallel - Parallel reduce and find-all on 1 to 16 threads\n");
+        printf(" 6. bench_concurrent_list - Concurrent list throughput on 1 to 16 threads\n");
+        printf(" 0. Run all benchmarks\n");
+        return 1;
+    }
+
+    switch (atoi(argv[1]))
+    {
+    case 0:
+        bench_list_compact(1000000);
+        bench_list_display(1000000);
+        bench_list_save_load(10000000);
+        bench_skiplist(1000000);
+        bench_list_parallel(10000000);
+        bench_concurrent_list(5000);
+        break;
+    case 1:
+        bench_list_compact(1000000);
+        break;
+    case 2:
+        bench_list_display(1000000);
+        break;
+    case 3:
+        bench_list_save_load(10000000);
+        break;
+    case 4:
+        bench_skiplist(1000000);
+        break;
+    case 5:
+        bench_list_parallel(10000000);
+        break;
+    case 6:
+        bench_concurrent_list(5000);
+        break;
+    default:
+        printf("Invalid benchmark\n");
+        break;
+    }
+
+    return 0;
+}
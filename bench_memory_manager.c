@@ -0,0 +1,796 @@
+#include "memory_manager.h"
+#include "memory_manager_inline.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "common_defs.h"
+#include "perf_counters.h"
+#include "gitdata.h"
+
+// Returns a monotonic timestamp in seconds.
+static double now_seconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// ********* Benchmarks *********
+
+void bench_batched_alloc_free(int count)
+{
+    printf_yellow("  Benchmarking mem_alloc/mem_free against the batched variants (%d blocks)\n", count);
+    void **blocks = malloc(sizeof(void *) * count);
+    size_t size = 16;
+
+    mem_init(size * count);
+    PerfScope perf = perf_begin();
+    double start = now_seconds();
+    for (int i = 0; i < count; i++)
+    {
+        blocks[i] = mem_alloc(size);
+        my_assert(blocks[i] != NULL);
+    }
+    double alloc_single = now_seconds() - start;
+    perf_end(&perf, "mem_alloc", count);
+    perf = perf_begin();
+    start = now_seconds();
+    for (int i = 0; i < count; i++)
+    {
+        mem_free(blocks[i]);
+    }
+    double free_single = now_seconds() - start;
+    perf_end(&perf, "mem_free", count);
+    mem_deinit();
+
+    mem_init(size * count);
+    perf = perf_begin();
+    start = now_seconds();
+    my_assert(mem_alloc_many(size, count, blocks) == (size_t)count);
+    double alloc_many = now_seconds() - start;
+    perf_end(&perf, "block of mem_alloc_many", count);
+    perf = perf_begin();
+    start = now_seconds();
+    mem_free_many(blocks, count);
+    double free_many = now_seconds() - start;
+    perf_end(&perf, "block of mem_free_many", count);
+    mem_deinit();
+
+    printf("\tmem_alloc x%d:     %10.2f ms\n", count, alloc_single * 1e3);
+    printf("\tmem_alloc_many:    %10.2f ms (%.0fx)\n", alloc_many * 1e3, alloc_single / alloc_many);
+    printf("\tmem_free x%d:      %10.2f ms\n", count, free_single * 1e3);
+    printf("\tmem_free_many:     %10.2f ms (%.0fx)\n", free_many * 1e3, free_single / free_many);
+
+    free(blocks);
+}
+
+void bench_cache_pairs(int pairs)
+{
+    printf_yellow("  Benchmarking alloc+free pairs, magazine cache against the shared pool (%d pairs)\n", pairs);
+    mem_init(16 * 1024 * 1024);
+    // A few long-lived blocks so the shared pool has a realistic block list to walk
+    void *resident[256];
+    my_assert(mem_alloc_many(64, 256, resident) == 256);
+
+    for (size_t size = 16; size <= 256; size *= 2)
+    {
+        char operation[64];
+        snprintf(operation, sizeof(operation), "%zu-byte mem_cache_alloc/free pair", size);
+        PerfScope perf = perf_begin();
+        double start = now_seconds();
+        for (int i = 0; i < pairs; i++)
+        {
+            void *p = mem_cache_alloc(size);
+            mem_cache_free(p, size);
+        }
+        double cached = (now_seconds() - start) * 1e9 / pairs;
+        perf_end(&perf, operation, pairs);
+
+        snprintf(operation, sizeof(operation), "%zu-byte mem_alloc/free pair", size);
+        perf = perf_begin();
+        start = now_seconds();
+        for (int i = 0; i < pairs; i++)
+        {
+            void *p = mem_alloc(size);
+            mem_free(p);
+        }
+        double shared = (now_seconds() - start) * 1e9 / pairs;
+        perf_end(&perf, operation, pairs);
+
+        printf("\t%3zu bytes: mem_cache_alloc/free %6.1f ns, mem_alloc/free %8.1f ns\n", size, cached, shared);
+    }
+
+    mem_cache_flush();
+    mem_deinit();
+}
+
+// Returns the bandwidth in GB/s of writing and then reading bytes at buffer, rounds times.
+static double measure_bandwidth(unsigned char *buffer, size_t bytes, int rounds)
+{
+    volatile unsigned long sink = 0;
+    double start = now_seconds();
+    for (int r = 0; r < rounds; r++)
+    {
+        memset(buffer, r, bytes);
+        unsigned long sum = 0;
+        const unsigned long *words = (const unsigned long *)buffer;
+        for (size_t i = 0; i < bytes / sizeof(unsigned long); i++)
+        {
+            sum += words[i];
+        }
+        sink += sum;
+    }
+    (void)sink;
+    return 2.0 * bytes * rounds / (now_seconds() - start) / 1e9;
+}
+
+void bench_numa_bandwidth(size_t megabytes)
+{
+    printf_yellow("  Benchmarking local against remote NUMA pool bandwidth (%zu MB per node)\n", megabytes);
+    size_t bytes = megabytes * 1024 * 1024;
+    int nodes = mem_init_numa(bytes + 4096);
+
+    // The node of a default allocation is the one this thread runs on
+    void *probe = mem_alloc(1);
+    int local = mem_numa_node_of(probe);
+    mem_free(probe);
+    printf("\t%d pool(s), running on node %d%s\n", nodes, local,
+           nodes == 1 ? " (single node: nothing remote to compare against)" : "");
+
+    for (int node = 0; node < nodes; node++)
+    {
+        mem_numa_set_node(node);
+        unsigned char *buffer = mem_alloc(bytes);
+        mem_numa_set_node(-1);
+        my_assert(buffer != NULL && mem_numa_node_of(buffer) == node);
+
+        measure_bandwidth(buffer, bytes, 1); // Fault the pages in
+        PerfScope perf = perf_begin();
+        double bandwidth = measure_bandwidth(buffer, bytes, 10);
+        perf_end(&perf, node == local ? "local cache line written and read" : "remote cache line written and read", 10.0 * bytes / 64);
+        printf("\tnode %d (%s): %6.2f GB/s\n", node, node == local ? "local" : "remote", bandwidth);
+        mem_free(buffer);
+    }
+
+    mem_deinit();
+}
+
+void bench_calloc(int count)
+{
+    printf_yellow("  Benchmarking mem_calloc against mem_alloc+memset (%d blocks of 1 MB)\n", count);
+    size_t size = 1024 * 1024;
+    void **blocks = malloc(sizeof(void *) * count);
+
+    // Right after start-up the pool is untouched, so mem_calloc has nothing to clear
+    mem_init(size * count);
+    PerfScope perf = perf_begin();
+    double start = now_seconds();
+    for (int i = 0; i < count; i++)
+    {
+        blocks[i] = mem_alloc(size);
+        memset(blocks[i], 0, size);
+    }
+    double alloc_memset = now_seconds() - start;
+    perf_end(&perf, "1 MB mem_alloc+memset", count);
+    mem_deinit();
+
+    mem_init(size * count);
+    perf = perf_begin();
+    start = now_seconds();
+    for (int i = 0; i < count; i++)
+    {
+        blocks[i] = mem_calloc(1, size);
+    }
+    double fresh = now_seconds() - start;
+    perf_end(&perf, "1 MB mem_calloc of fresh memory", count);
+
+    // Reused memory has to be cleared
+    for (int i = 0; i < count; i++)
+    {
+        memset(blocks[i], 0xFF, size);
+    }
+    mem_free_many(blocks, count);
+    perf = perf_begin();
+    start = now_seconds();
+    for (int i = 0; i < count; i++)
+    {
+        blocks[i] = mem_calloc(1, size);
+    }
+    double reused = now_seconds() - start;
+    perf_end(&perf, "1 MB mem_calloc of reused memory", count);
+    mem_deinit();
+
+    printf("\tmem_alloc+memset:     %8.2f ms\n", alloc_memset * 1e3);
+    printf("\tmem_calloc, fresh:    %8.2f ms (%.0fx)\n", fresh * 1e3, alloc_memset / fresh);
+    printf("\tmem_calloc, reused:   %8.2f ms\n", reused * 1e3);
+
+    free(blocks);
+}
+
+// One step of an allocation trace: allocate size bytes into slot, or free slot (size 0).
+typedef struct TraceOp
+{
+    int slot;
+    size_t size;
+} TraceOp;
+
+#define TRACE_SLOTS 4096
+
+// Generates a trace of count operations: slots are picked at random, an empty slot is
+// allocated and a full one freed. large_percent of the allocations are 1-64 KB, the
+// rest 16-256 bytes.
+static TraceOp *generate_trace(int count, int large_percent)
+{
+    TraceOp *trace = malloc(sizeof(TraceOp) * count);
+    char live[TRACE_SLOTS] = {0};
+    for (int i = 0; i < count; i++)
+    {
+        int slot = rand() % TRACE_SLOTS;
+        trace[i].slot = slot;
+        trace[i].size = 0;
+        if (!live[slot])
+        {
+            trace[i].size = rand() % 100 < large_percent ? 1024 + rand() % (63 * 1024) : 16 + rand() % 241;
+        }
+        live[slot] = !live[slot];
+    }
+    return trace;
+}
+
+// Reads a trace file with one "a <slot> <size>" or "f <slot>" line per operation.
+// Returns the trace, or NULL if the file cannot be read.
+static TraceOp *load_trace(const char *path, int *count)
+{
+    FILE *file = fopen(path, "r");
+    if (!file)
+    {
+        perror(path);
+        return NULL;
+    }
+    int slots = 1024;
+    TraceOp *trace = malloc(sizeof(TraceOp) * slots);
+    char op;
+    int slot;
+    *count = 0;
+    while (fscanf(file, " %c %d", &op, &slot) == 2)
+    {
+        size_t size = 0;
+        if (op == 'a' && fscanf(file, "%zu", &size) != 1)
+        {
+            break;
+        }
+        if (slot < 0 || slot >= TRACE_SLOTS)
+        {
+            continue;
+        }
+        if (*count == slots)
+        {
+            slots *= 2;
+            trace = realloc(trace, sizeof(TraceOp) * slots);
+        }
+        trace[*count].slot = slot;
+        trace[*count].size = op == 'a' && size == 0 ? 1 : size;
+        (*count)++;
+    }
+    fclose(file);
+    return trace;
+}
+
+// Runs a trace against the current pool and returns the number of failed allocations;
+// blocks still live at the end are left allocated.
+static int run_trace(TraceOp *trace, int count)
+{
+    void *slots[TRACE_SLOTS] = {NULL};
+    int failed = 0;
+    for (int i = 0; i < count; i++)
+    {
+        void **slot = &slots[trace[i].slot];
+        if (trace[i].size == 0 || *slot)
+        {
+            if (*slot)
+            {
+                mem_free(*slot);
+                *slot = NULL;
+            }
+        }
+        else if ((*slot = mem_alloc(trace[i].size)) == NULL)
+        {
+            failed++;
+        }
+    }
+    return failed;
+}
+
+// Replays a trace under every placement policy and prints throughput and fragmentation.
+static void replay_trace(const char *name, TraceOp *trace, int count, size_t pool_size)
+{
+    static const char *names[] = {"first fit", "next fit", "best fit", "worst fit"};
+    static const MemPolicy policies[] = {MEM_FIRST_FIT, MEM_NEXT_FIT, MEM_BEST_FIT, MEM_WORST_FIT};
+    printf("\t%s (%d operations, %zu KB pool):\n", name, count, pool_size / 1024);
+    for (int p = 0; p < 4; p++)
+    {
+        mem_set_policy(policies[p]);
+        mem_init(pool_size);
+        char operation[64];
+        snprintf(operation, sizeof(operation), "%s trace operation", names[p]);
+        PerfScope perf = perf_begin();
+        double start = now_seconds();
+        int failed = run_trace(trace, count);
+        double elapsed = now_seconds() - start;
+        perf_end(&perf, operation, count);
+
+        MemStats stats;
+        mem_get_stats(&stats);
+        double fragmentation = stats.free_bytes ? 1.0 - (double)stats.largest_free / stats.free_bytes : 0;
+        printf("\t  %-9s %8.2f Mops/s, %6d failed, %6zu free blocks, fragmentation %5.1f%%\n",
+               names[p], count / elapsed / 1e6, failed, stats.free_blocks, fragmentation * 100);
+        mem_deinit();
+    }
+    mem_set_policy(MEM_FIRST_FIT);
+}
+
+void bench_policies(int count, const char *trace_path)
+{
+    printf_yellow("  Benchmarking placement policies on allocation traces\n");
+    if (trace_path)
+    {
+        int loaded;
+        TraceOp *trace = load_trace(trace_path, &loaded);
+        if (trace)
+        {
+            replay_trace(trace_path, trace, loaded, 64 * 1024 * 1024);
+            free(trace);
+        }
+        return;
+    }
+
+    TraceOp *small = generate_trace(count, 0);
+    replay_trace("small objects", small, count, 512 * 1024);
+    free(small);
+
+    TraceOp *mixed = generate_trace(count, 5);
+    replay_trace("mixed sizes", mixed, count, 8 * 1024 * 1024);
+    free(mixed);
+}
+
+// Main function to run the benchmarks
+void bench_bitmap(int count)
+{
+    printf_yellow("  Benchmarking a bitmap pool against the block list on small objects\n");
+    TraceOp *trace = generate_trace(count, 0);
+    size_t pool_size = 2 * 1024 * 1024;
+
+    mem_init(pool_size);
+    PerfScope perf = perf_begin();
+    double start = now_seconds();
+    int failed = run_trace(trace, count);
+    double elapsed = now_seconds() - start;
+    perf_end(&perf, "block list trace operation", count);
+    printf("\tblock list:          %8.2f Mops/s, %6d failed\n", count / elapsed / 1e6, failed);
+    mem_deinit();
+
+    for (size_t granule = 16; granule <= 64; granule *= 2)
+    {
+        mem_init_bitmap(pool_size, granule);
+        char operation[64];
+        snprintf(operation, sizeof(operation), "%zu B bitmap trace operation", granule);
+        perf = perf_begin();
+        start = now_seconds();
+        failed = run_trace(trace, count);
+        elapsed = now_seconds() - start;
+        perf_end(&perf, operation, count);
+        printf("\tbitmap, %2zu B granule: %8.2f Mops/s, %6d failed, %zu bytes of bitmaps\n",
+               granule, count / elapsed / 1e6, failed, 2 * (pool_size / granule / 8));
+        mem_deinit();
+    }
+    free(trace);
+}
+
+void bench_inline_pairs(int pairs)
+{
+    printf_yellow("  Benchmarking alloc+free pairs, inline fast path against the cache entry points (%d pairs)\n", pairs);
+    mem_init(16 * 1024 * 1024);
+    for (size_t size = 16; size <= 256; size *= 4)
+    {
+        char operation[64];
+        snprintf(operation, sizeof(operation), "%zu-byte inline pair", size);
+        PerfScope perf = perf_begin();
+        double start = now_seconds();
+        for (int i = 0; i < pairs; i++)
+        {
+            void *p = mem_alloc_inline(size);
+            mem_free_inline(p, size);
+        }
+        double inlined = (now_seconds() - start) * 1e9 / pairs;
+        perf_end(&perf, operation, pairs);
+
+        snprintf(operation, sizeof(operation), "%zu-byte mem_cache_alloc/free pair", size);
+        perf = perf_begin();
+        start = now_seconds();
+        for (int i = 0; i < pairs; i++)
+        {
+            void *p = mem_cache_alloc(size);
+            mem_cache_free(p, size);
+        }
+        double cached = (now_seconds() - start) * 1e9 / pairs;
+        perf_end(&perf, operation, pairs);
+
+        printf("\t%3zu bytes: mem_alloc_inline/mem_free_inline %6.1f ns, mem_cache_alloc/free %6.1f ns\n", size, inlined, cached);
+    }
+    mem_inline_flush();
+    mem_cache_flush();
+    mem_deinit();
+}
+
+// List node stored in a pool file; links are offsets from mem_pool_base(), so the list
+// stays valid wherever the file is mapped
+typedef struct FileNode
+{
+    size_t next;  // Offset of the next node plus one, 0 at the end
+    long value;
+} FileNode;
+
+void bench_file_restart(int nodes)
+{
+    printf_yellow("  Benchmarking a warm restart from a pool file against rebuilding a %d-node list\n", nodes);
+    char path[] = "/tmp/bench_memory_manager_pool_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0)
+    {
+        perror("mkstemp");
+        return;
+    }
+    close(fd);
+    size_t pool_size = (size_t)nodes * sizeof(FileNode) * 2;
+
+    // Best fit finds every block in O(log n), where first fit would walk all nodes so far
+    mem_set_policy(MEM_BEST_FIT);
+    PerfScope perf = perf_begin();
+    double start = now_seconds();
+    mem_init_file(path, pool_size);
+    char *base = mem_pool_base();
+    size_t head = 0;
+    for (int i = 0; i < nodes; i++)
+    {
+        FileNode *node = mem_alloc(sizeof(FileNode));
+        node->value = i;
+        node->next = head;
+        head = (size_t)((char *)node - base) + 1;
+    }
+    mem_set_root(0, base + head - 1);
+    double built = now_seconds() - start;
+    perf_end(&perf, "node built", nodes);
+    mem_deinit();
+    mem_set_policy(MEM_FIRST_FIT);
+
+    perf = perf_begin();
+    start = now_seconds();
+    int restored = mem_init_file(path, 0);
+    base = mem_pool_base();
+    FileNode *node = mem_root(0);
+    double mapped = now_seconds() - start;
+    long sum = 0;
+    for (; node != NULL; node = node->next ? (FileNode *)(base + node->next - 1) : NULL)
+    {
+        sum += node->value;
+    }
+    double walked = now_seconds() - start;
+    perf_end(&perf, "node restored and walked", nodes);
+    mem_deinit();
+    unlink(path);
+
+    printf("\tbuild: %8.2f ms, restore: %8.3f ms (%s), restore and walk: %8.2f ms, checksum %s\n",
+           built * 1e3, mapped * 1e3, restored == 1 ? "restored" : "failed", walked * 1e3,
+           sum == (long)nodes * (nodes - 1) / 2 ? "ok" : "wrong");
+}
+
+// Writes or reads exactly bytes bytes through a pipe.
+static int pipe_transfer(int fd, void *buffer, size_t bytes, int writing)
+{
+    char *p = buffer;
+    while (bytes > 0)
+    {
+        ssize_t n = writing ? write(fd, p, bytes) : read(fd, p, bytes);
+        if (n <= 0)
+        {
+            return -1;
+        }
+        p += n;
+        bytes -= (size_t)n;
+    }
+    return 0;
+}
+
+#define HANDOFF_IN_FLIGHT 16
+
+// Consumer of bench_shared_handoff: checks every buffer it receives, by offset into the
+// shared pool when zero_copy is set, through the pipe otherwise.
+static void handoff_consumer(int in, int acks, size_t size, int buffers, int zero_copy)
+{
+    unsigned char *copy = zero_copy ? NULL : malloc(size);
+    long bad = 0;
+    for (int i = 0; i < buffers; i++)
+    {
+        unsigned char *buffer = copy;
+        size_t offset;
+        if (zero_copy)
+        {
+            pipe_transfer(in, &offset, sizeof(offset), 0);
+            buffer = mem_from_offset(offset);
+        }
+        else
+        {
+            pipe_transfer(in, copy, size, 0);
+        }
+        bad += buffer[0] != (unsigned char)i || buffer[size - 1] != (unsigned char)i;
+        if (zero_copy)
+        {
+            mem_free(buffer);
+        }
+        char ack = 1;
+        pipe_transfer(acks, &ack, 1, 1);
+    }
+    free(copy);
+    _exit(bad != 0);
+}
+
+void bench_shared_handoff(int buffers, size_t size)
+{
+    printf_yellow("  Benchmarking a fork-based producer/consumer: shared pool hand-off against copying through a pipe (%d x %zu KB)\n", buffers, size / 1024);
+    char name[64];
+    snprintf(name, sizeof(name), "/bench_memory_manager_%d", (int)getpid());
+    shm_unlink(name);
+    if (mem_init_shared(name, (HANDOFF_IN_FLIGHT + 1) * size * 2) != 0)
+    {
+        perror("mem_init_shared");
+        return;
+    }
+
+    for (int zero_copy = 1; zero_copy >= 0; zero_copy--)
+    {
+        int data[2], acks[2];
+        if (pipe(data) != 0 || pipe(acks) != 0)
+        {
+            perror("pipe");
+            break;
+        }
+        PerfScope perf = perf_begin();  // Counts the consumer too
+        double start = now_seconds();
+        pid_t child = fork();
+        if (child == 0)
+        {
+            close(data[1]);
+            close(acks[0]);
+            handoff_consumer(data[0], acks[1], size, buffers, zero_copy);
+        }
+        close(data[0]);
+        close(acks[1]);
+
+        unsigned char *staging = zero_copy ? NULL : malloc(size);
+        for (int i = 0; i < buffers; i++)
+        {
+            // Wait for the consumer once HANDOFF_IN_FLIGHT buffers are on their way
+            char ack;
+            if (i >= HANDOFF_IN_FLIGHT)
+            {
+                pipe_transfer(acks[0], &ack, 1, 0);
+            }
+            unsigned char *buffer = zero_copy ? mem_alloc(size) : staging;
+            memset(buffer, (unsigned char)i, size);
+            if (zero_copy)
+            {
+                size_t offset = mem_to_offset(buffer);
+                pipe_transfer(data[1], &offset, sizeof(offset), 1);
+            }
+            else
+            {
+                pipe_transfer(data[1], buffer, size, 1);
+            }
+        }
+        for (int i = buffers > HANDOFF_IN_FLIGHT ? HANDOFF_IN_FLIGHT : buffers; i > 0; i--)
+        {
+            char ack;
+            pipe_transfer(acks[0], &ack, 1, 0);
+        }
+        int status;
+        waitpid(child, &status, 0);
+        double elapsed = now_seconds() - start;
+        perf_end(&perf, zero_copy ? "buffer handed off" : "buffer copied", buffers);
+        free(staging);
+        close(data[1]);
+        close(acks[0]);
+        printf("\t%-22s %8.2f GB/s, %6.1f us per buffer, consumer %s\n",
+               zero_copy ? "shared pool hand-off:" : "copy through a pipe:",
+               (double)buffers * size / elapsed / 1e9, elapsed * 1e6 / buffers,
+               WIFEXITED(status) && WEXITSTATUS(status) == 0 ? "ok" : "saw bad data");
+    }
+    mem_deinit();
+    shm_unlink(name);
+}
+
+// Returns the resident set size of the process in bytes.
+static size_t resident_bytes(void)
+{
+    long pages = 0;
+    FILE *statm = fopen("/proc/self/statm", "r");
+    if (statm)
+    {
+        if (fscanf(statm, "%*ld %ld", &pages) != 1)
+        {
+            pages = 0;
+        }
+        fclose(statm);
+    }
+    return (size_t)pages * (size_t)sysconf(_SC_PAGESIZE);
+}
+
+#define LIFETIME_SMALL 1024         // Short-lived objects of the small phases
+#define LIFETIME_LARGE (64 * 1024)  // Short-lived buffers of the large phases
+#define LIFETIME_RECORD 64          // Long-lived records, one per LIFETIME_EVERY small objects
+#define LIFETIME_EVERY 16
+
+// Runs rounds of a mixed-lifetime trace: a burst of small short-lived objects with a
+// long-lived record allocated after every LIFETIME_EVERY of them, freed again, then a
+// burst of large short-lived buffers of the same total size, freed again. All memory is
+// written, so it is resident. Short-lived requests carry the MEM_SHORT_LIVED hint, and
+// bursts are freed with mem_free_many.
+// Returns:
+// - The peak resident set size above the one before the trace, in bytes.
+static size_t run_lifetimes(int rounds, size_t burst_bytes, double *elapsed)
+{
+    int small_count = (int)(burst_bytes / LIFETIME_SMALL);
+    int large_count = (int)(burst_bytes / LIFETIME_LARGE);
+    int record_count = rounds * (small_count / LIFETIME_EVERY);
+    void **burst = malloc(sizeof(void *) * small_count);
+    void **records = malloc(sizeof(void *) * record_count);
+    int records_used = 0;
+
+    size_t baseline = resident_bytes();
+    size_t peak = baseline;
+    double start = now_seconds();
+    for (int r = 0; r < rounds; r++)
+    {
+        for (int i = 0; i < small_count; i++)
+        {
+            burst[i] = mem_alloc_hint(LIFETIME_SMALL, MEM_SHORT_LIVED);
+            my_assert(burst[i] != NULL);
+            memset(burst[i], i, LIFETIME_SMALL);
+            if (i % LIFETIME_EVERY == LIFETIME_EVERY - 1)
+            {
+                records[records_used] = mem_alloc(LIFETIME_RECORD);
+                my_assert(records[records_used] != NULL);
+                memset(records[records_used++], r, LIFETIME_RECORD);
+            }
+        }
+        size_t resident = resident_bytes();
+        peak = resident > peak ? resident : peak;
+        mem_free_many(burst, small_count);
+
+        for (int i = 0; i < large_count; i++)
+        {
+            burst[i] = mem_alloc_hint(LIFETIME_LARGE, MEM_SHORT_LIVED);
+            my_assert(burst[i] != NULL);
+            memset(burst[i], i, LIFETIME_LARGE);
+        }
+        resident = resident_bytes();
+        peak = resident > peak ? resident : peak;
+        mem_free_many(burst, large_count);
+    }
+    *elapsed = now_seconds() - start;
+
+    mem_free_many(records, records_used);
+    free(records);
+    free(burst);
+    return peak - baseline;
+}
+
+void bench_lifetimes(int rounds, size_t burst_megabytes)
+{
+    printf_yellow("  Benchmarking peak RSS of a mixed-lifetime trace (%d rounds of %zu MB bursts)\n", rounds, burst_megabytes);
+    size_t burst_bytes = burst_megabytes * 1024 * 1024;
+    size_t pool_size = burst_bytes * 4;
+    double elapsed;
+
+    // Both layouts use mapped regions, which return large free blocks to the kernel. Best
+    // fit finds every block in O(log n), where first fit would walk the live bursts.
+    mem_set_policy(MEM_BEST_FIT);
+    my_assert(mem_grow(pool_size) == 0);
+    PerfScope perf = perf_begin();
+    size_t shared = run_lifetimes(rounds, burst_bytes, &elapsed);
+    perf_end(&perf, "round in one pool", rounds);
+    mem_deinit();
+    printf("	one pool:             peak RSS %7.1f MB, %8.2f ms\n", shared / 1048576.0, elapsed * 1e3);
+
+    my_assert(mem_grow(pool_size) == 0);
+    my_assert(mem_grow_hint(pool_size, MEM_SHORT_LIVED) == 0);
+    perf = perf_begin();
+    size_t split = run_lifetimes(rounds, burst_bytes, &elapsed);
+    perf_end(&perf, "round with a sub-pool", rounds);
+    mem_deinit();
+    mem_set_policy(MEM_FIRST_FIT);
+    printf("	short-lived sub-pool: peak RSS %7.1f MB, %8.2f ms (%.1fx less memory)\n", split / 1048576.0,
+           elapsed * 1e3, split > 0 ? (double)shared / split : 0.0);
+}
+
+int main(int argc, char *argv[])
+{
+    srand(12345);
+#ifdef VERSION
+    printf("Build Version; %s \n", VERSION);
+#endif
+    printf("Git Version; %s/%s \n", git_date, git_sha);
+    if (argc < 2)
+    {
+        printf("Usage: %s <benchmark>\n", argv[0]);
+        printf("Available benchmarks:\n");
+        printf(" 1. bench_batched_alloc_free - Per-block against batched allocation and free\n");
+        printf(" 2. bench_cache_pairs - Alloc+free pairs through the magazine cache and the shared pool\n");
+        printf(" 3. bench_numa_bandwidth - Access bandwidth of the local and the remote NUMA pools\n");
+        printf(" 4. bench_calloc - Zeroed allocation of fresh and reused memory\n");
+        printf(" 5. bench_policies [trace file] - Placement policies on generated traces or a trace\n");
+        printf("    file of \"a <slot> <size>\" and \"f <slot>\" lines (slots below %d)\n", TRACE_SLOTS);
+        printf(" 6. bench_bitmap - Small objects in a bitmap pool and in the block list\n");
+        printf(" 7. bench_inline_pairs - Alloc+free pairs through the inline fast path\n");
+        printf(" 8. bench_file_restart - Restoring a list from a pool file against building it\n");
+        printf(" 9. bench_shared_handoff - Handing buffers to a forked process through a shared pool\n");
+        printf(" 10. bench_lifetimes - Peak RSS of a mixed-lifetime trace with and without lifetime hints\n");
+        printf(" 0. Run all benchmarks\n");
+        return 1;
+    }
+
+    switch (atoi(argv[1]))
+    {
+    case 0:
+        bench_batched_alloc_free(20000);
+        bench_cache_pairs(1000000);
+        bench_numa_bandwidth(256);
+        bench_calloc(256);
+        bench_policies(100000, NULL);
+        bench_bitmap(100000);
+        bench_inline_pairs(10000000);
+        bench_file_restart(1000000);
+        bench_shared_handoff(2000, 1024 * 1024);
+        bench_lifetimes(4, 32);
+        break;
+    case 1:
+        bench_batched_alloc_free(20000);
+        break;
+    case 2:
+        bench_cache_pairs(1000000);
+        break;
+    case 3:
+        bench_numa_bandwidth(256);
+        break;
+    case 4:
+        bench_calloc(256);
+        break;
+    case 5:
+        bench_policies(100000, argc > 2 ? argv[2] : NULL);
+        break;
+    case 6:
+        bench_bitmap(100000);
+        break;
+    case 7:
+        bench_inline_pairs(10000000);
+        break;
+    case 8:
+        bench_file_restart(1000000);
+        break;
+    case 9:
+        bench_shared_handoff(2000, 1024 * 1024);
+        break;
+    case 10:
+        bench_lifetimes(4, 32);
+        break;
+    default:
+        printf("Invalid benchmark\n");
+        break;
+    }
+
+    return 0;
+}
@@ -0,0 +1,102 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+// Generates memory_manager_classes.h, the size classes of the magazine caches, from the
+// class sizes given on the command line (see SIZE_CLASSES in the Makefile):
+//
+//     ./gen_size_classes 16 32 48 64 96 128 > memory_manager_classes.h
+//
+// Sizes must be ascending multiples of CLASS_ALIGN, so that blocks carved back to back
+// from the pool stay aligned, and at most CLASS_LIMIT bytes.
+
+#define CLASS_ALIGN 16         // Granularity of the size lookup table
+#define CLASS_LIMIT 4096       // Largest class size
+#define MAGAZINE_BYTES 4096    // Bytes a magazine of a class holds, roughly
+#define MIN_ROUNDS 8           // Fewest blocks per magazine
+#define MAX_ROUNDS 64          // Most blocks per magazine
+
+int main(int argc, char *argv[])
+{
+    int count = argc - 1;
+    if (count < 1 || count > 255)
+    {
+        fprintf(stderr, "Usage: %s <class size>... (1 to 255 sizes)\n", argv[0]);
+        return 1;
+    }
+    int sizes[256];
+    for (int i = 0; i < count; i++)
+    {
+        sizes[i] = atoi(argv[i + 1]);
+        if (sizes[i] <= 0 || sizes[i] % CLASS_ALIGN != 0 || sizes[i] > CLASS_LIMIT || (i > 0 && sizes[i] <= sizes[i - 1]))
+        {
+            fprintf(stderr, "%s: class sizes must be ascending multiples of %d up to %d, got %s\n",
+                    argv[0], CLASS_ALIGN, CLASS_LIMIT, argv[i + 1]);
+            return 1;
+        }
+    }
+    int max_size = sizes[count - 1];
+
+    printf("// Generated by gen_size_classes from SIZE_CLASSES in the Makefile; do not edit.\n");
+    printf("#ifndef MEMORY_MANAGER_CLASSES_H\n#define MEMORY_MANAGER_CLASSES_H\n\n");
+    printf("#include <stddef.h>\n#include <stdint.h>\n#include \"memory_manager.h\"\n\n");
+    printf("#define MEM_SIZE_CLASSES          %-5d // Number of size classes\n", count);
+    printf("#define MEM_SIZE_CLASS_MAX        %-5d // Largest size served by a class\n", max_size);
+    printf("#define MEM_SIZE_CLASS_MAX_ROUNDS %-5d // Capacity of the largest magazine\n\n", MAX_ROUNDS);
+
+    printf("// Class of every size, by (size + %d) / %d\n", CLASS_ALIGN - 1, CLASS_ALIGN);
+    printf("static const uint8_t mem_size_class_index[%d] = {", max_size / CLASS_ALIGN + 1);
+    int class_index = 0;
+    for (int slot = 0; slot <= max_size / CLASS_ALIGN; slot++)
+    {
+        while (sizes[class_index] < slot * CLASS_ALIGN)
+        {
+            class_index++;
+        }
+        printf("%s%d", slot % 16 == 0 ? "\n    " : " ", class_index);
+        if (slot < max_size / CLASS_ALIGN)
+        {
+            printf(",");
+        }
+    }
+    printf("\n};\n\n");
+
+    printf("// Block size of every class\n");
+    printf("static const uint32_t mem_size_class_bytes[MEM_SIZE_CLASSES] = {");
+    for (int i = 0; i < count; i++)
+    {
+        printf("%s%d", i == 0 ? " " : ", ", sizes[i]);
+    }
+    printf(" };\n\n");
+
+    printf("// Blocks per magazine of every class: about %d bytes, %d to %d blocks\n", MAGAZINE_BYTES, MIN_ROUNDS, MAX_ROUNDS);
+    printf("static const uint8_t mem_size_class_rounds[MEM_SIZE_CLASSES] = {");
+    for (int i = 0; i < count; i++)
+    {
+        int rounds = MAGAZINE_BYTES / sizes[i];
+        rounds = rounds < MIN_ROUNDS ? MIN_ROUNDS : rounds > MAX_ROUNDS ? MAX_ROUNDS : rounds;
+        printf("%s%d", i == 0 ? " " : ", ", rounds);
+    }
+    printf(" };\n\n");
+
+    printf("// Class of an exact class size, for callers that know their size\n");
+    for (int i = 0; i < count; i++)
+    {
+        printf("#define MEM_SIZE_CLASS_%d %d\n", sizes[i], i);
+    }
+
+    printf("\n// Returns the class of a size of at most MEM_SIZE_CLASS_MAX bytes.\n");
+    printf("static inline unsigned mem_size_class(size_t size) {\n");
+    printf("    return mem_size_class_index[(size + %d) / %d];\n}\n\n", CLASS_ALIGN - 1, CLASS_ALIGN);
+
+    printf("// mem_cache_alloc and mem_cache_free with the class lookup inlined; for a constant\n");
+    printf("// size the compiler resolves the class and drops the size check.\n");
+    printf("static inline void* mem_cache_alloc_sized(size_t size) {\n");
+    printf("    return size <= MEM_SIZE_CLASS_MAX ? mem_cache_alloc_class(mem_size_class(size)) : mem_alloc(size);\n}\n\n");
+    printf("static inline void mem_cache_free_sized(void* ptr, size_t size) {\n");
+    printf("    if (size <= MEM_SIZE_CLASS_MAX) {\n");
+    printf("        mem_cache_free_class(ptr, mem_size_class(size));\n");
+    printf("    } else if (ptr) {\n");
+    printf("        mem_free(ptr);\n    }\n}\n\n");
+    printf("#endif // MEMORY_MANAGER_CLASSES_H\n");
+    return 0;
+}
@@ -1,12 +1,289 @@
+#include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "memory_manager.h"
+#include "linked_list.h"
 
-// Definition of a singly linked list node.
-typedef struct Node {
-    uint16_t data;        // The data stored in the node.
-    struct Node* next;    // Pointer to the next node in the list.
-} Node;
+// Number of nodes requested from the memory manager for the first chunk; every
+// further chunk doubles in size up to NODE_CHUNK_MAX.
+#define NODE_CHUNK_MIN 16
+#define NODE_CHUNK_MAX 1024
+
+// A contiguous run of node slots carved out of the memory pool with a single mem_alloc.
+typedef struct NodeChunk {
+    char* base;           // First slot of the chunk inside the memory pool.
+    size_t capacity;      // Number of slots in the chunk.
+    size_t used;          // Slots handed out at least once (bump index).
+    size_t live;          // Slots currently holding a node.
+    size_t free_head;     // Index of the first released slot, or capacity if none.
+    bool open;            // Listed on the pool's open stack.
+} NodeChunk;
+
+// Typed node allocator used by the list instead of per-node mem_alloc calls.
+// Released slots are kept on a per-chunk free list of 32-bit slot indices,
+// threaded through the released slots themselves. Chunks that had a slot released
+// are pushed on the open stack, so a full current chunk is replaced in O(1); entries
+// whose chunk has filled up again are dropped when they reach the top.
+typedef struct NodePool {
+    size_t node_size;     // Size of one slot in bytes.
+    NodeChunk* chunks;    // Chunk descriptors, sorted by base address.
+    size_t chunk_count;   // Number of chunks in use.
+    size_t chunk_slots;   // Allocated length of the chunks and open arrays.
+    size_t current;       // Chunk that new nodes are taken from.
+    size_t* open;         // Stack of chunk indices that may have a free slot.
+    size_t open_count;    // Entries on the open stack.
+} NodePool;
+
+static NodePool node_pool = { sizeof(Node), NULL, 0, 0, 0, NULL, 0 };
+static NodePool cnode_pool = { sizeof(CNode), NULL, 0, 0, 0, NULL, 0 };
+static NodePool index_pool = { sizeof(SkipIndex), NULL, 0, 0, 0, NULL, 0 };
+
+// Base address that compact list links are relative to.
+static char* cnode_base = NULL;
+
+// Returns the address of slot index within a chunk.
+static inline void* chunk_slot(NodePool* pool, NodeChunk* chunk, size_t index) {
+    return chunk->base + index * pool->node_size;
+}
+
+// Finds the chunk holding the given node with a binary search over the chunk table.
+// Returns:
+// - The index of the chunk, or pool->chunk_count if the node is not in the pool.
+static size_t node_pool_find(NodePool* pool, const void* node) {
+    size_t low = 0, high = pool->chunk_count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        NodeChunk* chunk = &pool->chunks[mid];
+        if ((const char*)node < chunk->base) {
+            high = mid;
+        } else if ((const char*)node >= chunk->base + chunk->capacity * pool->node_size) {
+            low = mid + 1;
+        } else {
+            return mid;
+        }
+    }
+    return pool->chunk_count;
+}
+
+// Records a block obtained from the memory manager as a new chunk of the pool.
+// Returns:
+// - The index of the new chunk, or pool->chunk_count if the chunk table cannot grow.
+static size_t node_pool_add_chunk(NodePool* pool, void* base, size_t capacity) {
+    if (pool->chunk_count == pool->chunk_slots) {
+        size_t slots = pool->chunk_slots ? pool->chunk_slots * 2 : 8;
+        NodeChunk* chunks = (NodeChunk*)realloc(pool->chunks, slots * sizeof(NodeChunk));
+        if (!chunks) {
+            return pool->chunk_count;
+        }
+        pool->chunks = chunks;
+        size_t* open = (size_t*)realloc(pool->open, slots * sizeof(size_t));
+        if (!open) {
+            return pool->chunk_count;
+        }
+        pool->open = open;
+        pool->chunk_slots = slots;
+    }
+
+    // Keep the table sorted by address so node_pool_find can bisect it.
+    size_t index = pool->chunk_count;
+    while (index > 0 && pool->chunks[index - 1].base > (char*)base) {
+        pool->chunks[index] = pool->chunks[index - 1];
+        index--;
+    }
+    pool->chunks[index] = (NodeChunk){ (char*)base, capacity, 0, 0, capacity, false };
+    pool->chunk_count++;
+    if (pool->current >= index && pool->current + 1 < pool->chunk_count) {
+        pool->current++;
+    }
+    for (size_t i = 0; i < pool->open_count; i++) {
+        if (pool->open[i] >= index) {
+            pool->open[i]++;
+        }
+    }
+    return index;
+}
+
+// Requests a new chunk from the memory manager and records it in the chunk table.
+// Chunks grow geometrically, and a request that does not fit is halved until it does.
+// Returns:
+// - The index of the new chunk, or pool->chunk_count if the memory pool is exhausted.
+static size_t node_pool_grow(NodePool* pool) {
+    size_t capacity = NODE_CHUNK_MIN;
+    for (size_t i = 0; i < pool->chunk_count && capacity < NODE_CHUNK_MAX; i++) {
+        capacity *= 2;
+    }
+    void* base = NULL;
+    while (capacity > 0 && (base = mem_alloc(capacity * pool->node_size)) == NULL) {
+        capacity /= 2;
+    }
+    if (!base) {
+        return pool->chunk_count;
+    }
+
+    size_t index = node_pool_add_chunk(pool, base, capacity);
+    if (index == pool->chunk_count) {
+        mem_free(base);
+    }
+    return index;
+}
+
+// Allocates count adjacent node slots as one dedicated chunk.
+// Returns:
+// - A pointer to the first slot, or NULL if the memory pool has no region large enough.
+static void* node_pool_alloc_run(NodePool* pool, size_t count) {
+    void* base = mem_alloc(count * pool->node_size);
+    if (!base) {
+        return NULL;
+    }
+    size_t index = node_pool_add_chunk(pool, base, count);
+    if (index == pool->chunk_count) {
+        mem_free(base);
+        return NULL;
+    }
+    pool->chunks[index].used = count;
+    pool->chunks[index].live = count;
+    return base;
+}
+
+// Hands chunks back to the memory manager in one batch (only those without live nodes
+// if only_empty is set) and drops them from the chunk table.
+static void node_pool_release_chunks(NodePool* pool, bool only_empty) {
+    void** bases = (void**)malloc(pool->chunk_count * sizeof(void*));
+    size_t released = 0, kept = 0;
+    for (size_t i = 0; i < pool->chunk_count; i++) {
+        if (!only_empty || pool->chunks[i].live == 0) {
+            if (bases) {
+                bases[released++] = pool->chunks[i].base;
+            } else {
+                mem_free(pool->chunks[i].base);
+            }
+        } else {
+            pool->chunks[kept++] = pool->chunks[i];
+        }
+    }
+    mem_free_many(bases, released);
+    free(bases);
+    pool->chunk_count = kept;
+    pool->current = 0;
+
+    // Indices have shifted; list the kept chunks that have room again
+    pool->open_count = 0;
+    for (size_t i = 0; i < kept; i++) {
+        pool->chunks[i].open = pool->chunks[i].live < pool->chunks[i].capacity;
+        if (pool->chunks[i].open) {
+            pool->open[pool->open_count++] = i;
+        }
+    }
+}
+
+// Hands chunks that no longer hold any node back to the memory manager.
+static void node_pool_trim(NodePool* pool) {
+    node_pool_release_chunks(pool, true);
+}
+
+// Takes a free slot from the chunk, preferring previously released slots.
+static void* chunk_take(NodePool* pool, NodeChunk* chunk) {
+    void* slot;
+    if (chunk->free_head != chunk->capacity) {
+        uint32_t next_free;
+        slot = chunk_slot(pool, chunk, chunk->free_head);
+        memcpy(&next_free, slot, sizeof(next_free));
+        chunk->free_head = next_free;
+    } else {
+        slot = chunk_slot(pool, chunk, chunk->used++);
+    }
+    chunk->live++;
+    return slot;
+}
+
+// Allocates one node slot from the node pool.
+// Returns:
+// - A pointer to the slot, or NULL if the memory pool is exhausted.
+static void* node_pool_alloc(NodePool* pool) {
+    if (pool->current < pool->chunk_count && pool->chunks[pool->current].live < pool->chunks[pool->current].capacity) {
+        return chunk_take(pool, &pool->chunks[pool->current]);
+    }
+
+    // The current chunk is full; reuse space released in another chunk before growing.
+    while (pool->open_count > 0) {
+        size_t i = pool->open[pool->open_count - 1];
+        if (pool->chunks[i].live < pool->chunks[i].capacity) {
+            pool->current = i;
+            return chunk_take(pool, &pool->chunks[i]);
+        }
+        pool->chunks[i].open = false;
+        pool->open_count--;
+    }
+
+    size_t index = node_pool_grow(pool);
+    if (index == pool->chunk_count) {
+        return NULL;
+    }
+    pool->current = index;
+    return chunk_take(pool, &pool->chunks[index]);
+}
+
+// Returns a node slot to the chunk it was taken from.
+// Errors:
+// - Prints a warning if the node does not belong to the node pool.
+static void node_pool_release(NodePool* pool, void* node) {
+    size_t index = node_pool_find(pool, node);
+    if (index == pool->chunk_count) {
+        fprintf(stderr, "Warning: Node %p not found in the node pool.\n", node);
+        return;
+    }
+
+    NodeChunk* chunk = &pool->chunks[index];
+    uint32_t next_free = (uint32_t)chunk->free_head;
+    memcpy(node, &next_free, sizeof(next_free));
+    chunk->free_head = (size_t)((char*)node - chunk->base) / pool->node_size;
+    chunk->live--;
+    if (!chunk->open) {
+        chunk->open = true;
+        pool->open[pool->open_count++] = index;
+    }
+}
+
+// Forgets all chunks without touching the memory manager (used when the pool is re-initialized).
+static void node_pool_forget(NodePool* pool) {
+    free(pool->chunks);
+    free(pool->open);
+    pool->chunks = NULL;
+    pool->open = NULL;
+    pool->chunk_count = 0;
+    pool->chunk_slots = 0;
+    pool->current = 0;
+    pool->open_count = 0;
+}
+
+// Hands every chunk back to the memory manager and forgets all nodes.
+static void node_pool_reset(NodePool* pool) {
+    node_pool_release_chunks(pool, false);
+    node_pool_forget(pool);
+}
+
+// Forgets every node pool and initializes the memory manager they allocate from.
+static void node_pools_init(size_t size) {
+    node_pool_forget(&node_pool);
+    node_pool_forget(&cnode_pool);
+    node_pool_forget(&index_pool);
+    mem_init(size);
+}
+
+// Releases every node pool and deinitializes the memory manager.
+static void node_pools_deinit(void) {
+    node_pool_reset(&node_pool);
+    node_pool_reset(&cnode_pool);
+    node_pool_reset(&index_pool);
+    mem_deinit();
+}
 
 // Initializes a linked list and the custom memory manager.
 // Parameters:
@@ -14,7 +291,7 @@ typedef struct Node {
 // - size: Size of the memory pool to be initialized.
 void list_init(Node** head, size_t size) {
     *head = NULL;
-    mem_init(size);
+    node_pools_init(size);
 }
 
 // Inserts a new node at the end of the list
@@ -24,7 +301,7 @@ void list_init(Node** head, size_t size) {
 // Errors:
 // - Prints an error message if memory allocation fails.
 void list_insert(Node** head, uint16_t data) {
-    Node* new_node = (Node*) mem_alloc(sizeof(Node));
+    Node* new_node = (Node*) node_pool_alloc(&node_pool);
     if (!new_node) {
         printf("Memory allocation failed\n");
         return;
@@ -56,7 +333,7 @@ void list_insert_after(Node* prev_node, uint16_t data) {
         return;
     }
 
-    Node* new_node = (Node*) mem_alloc(sizeof(Node));
+    Node* new_node = (Node*) node_pool_alloc(&node_pool);
     if (!new_node) {
         printf("Memory allocation failed\n");
         return;
@@ -81,7 +358,7 @@ void list_insert_before(Node** head, Node* next_node, uint16_t data) {
         return;
     }
 
-    Node* new_node = (Node*) mem_alloc(sizeof(Node));
+    Node* new_node = (Node*) node_pool_alloc(&node_pool);
     if (!new_node) {
         printf("Memory allocation failed\n");
         return;
@@ -101,7 +378,7 @@ void list_insert_before(Node** head, Node* next_node, uint16_t data) {
 
     if (current == NULL) {
         printf("The specified next node is not in the list\n");
-        mem_free(new_node);
+        node_pool_release(&node_pool, new_node);
         return;
     }
 
@@ -109,6 +386,29 @@ void list_insert_before(Node** head, Node* next_node, uint16_t data) {
     current->next = new_node;
 }
 
+// Inserts a new node in front of the first node with a larger value, so that an
+// ascending list stays sorted.
+// Parameters:
+// - head: Pointer to the head pointer of the linked list.
+// - data: The data to be inserted into the new node.
+// Errors:
+// - Prints an error message if memory allocation fails.
+void list_insert_sorted(Node** head, uint16_t data) {
+    Node* new_node = (Node*) node_pool_alloc(&node_pool);
+    if (!new_node) {
+        printf("Memory allocation failed\n");
+        return;
+    }
+    new_node->data = data;
+
+    Node** link = head;
+    while (*link != NULL && (*link)->data < data) {
+        link = &(*link)->next;
+    }
+    new_node->next = *link;
+    *link = new_node;
+}
+
 // Deletes the first node with the specified data.
 // Parameters:
 // - head: Pointer to the head pointer of the linked list.
@@ -141,7 +441,7 @@ void list_delete(Node** head, uint16_t data) {
         previous->next = current->next;
     }
 
-    mem_free(current);
+    node_pool_release(&node_pool, current);
 }
 
 // Searches for a node with the specified data.
@@ -161,39 +461,158 @@ Node* list_search(Node** head, uint16_t data) {
     return NULL;
 }
 
-// Displays all elements in the list.
-// Parameters:
-// - head: Pointer to the head pointer of the linked list.
-void list_display(Node** head) {
-    Node* current = *head;
-    printf("[");
+// Size of the stack buffer used by the display functions.
+#define DISPLAY_BUFFER_SIZE 4096
+
+// Longest text emitted for one element: "65535, ".
+#define ELEMENT_TEXT_MAX 7
+
+// Output buffer used to serialize lists without per-element stdio calls.
+// With a stream the buffer is flushed whenever it fills up; without one the output
+// is truncated at the end of the buffer while total keeps counting.
+typedef struct OutBuffer {
+    char* data;           // Caller-provided storage.
+    size_t size;          // Capacity of data in bytes.
+    size_t len;           // Bytes currently held in data.
+    size_t total;         // Bytes the complete output takes.
+    FILE* stream;         // Destination of flushed bytes, or NULL for a fixed buffer.
+} OutBuffer;
+
+// Writes the buffered bytes to the stream and empties the buffer.
+static void out_flush(OutBuffer* out) {
+    if (out->stream && out->len > 0) {
+        fwrite(out->data, 1, out->len, out->stream);
+        out->len = 0;
+    }
+}
+
+// Appends bytes to the buffer, flushing or truncating when it is full.
+static void out_put(OutBuffer* out, const char* text, size_t n) {
+    out->total += n;
+    if (out->len + n > out->size) {
+        out_flush(out);
+    }
+    if (out->len + n > out->size) {
+        n = out->size - out->len;
+    }
+    memcpy(out->data + out->len, text, n);
+    out->len += n;
+}
+
+// Two-character decimal text of 00..99, used to emit two digits per division.
+static const char digit_pairs[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+// Converts a 16-bit value to decimal text.
+// Returns:
+// - The number of characters written to text (at most 5, no terminator).
+static inline size_t format_u16(char* text, uint16_t value) {
+    char digits[5];
+    char* end = digits + sizeof(digits);
+    char* p = end;
+    while (value >= 100) {
+        unsigned pair = (value % 100) * 2;
+        value /= 100;
+        *--p = digit_pairs[pair + 1];
+        *--p = digit_pairs[pair];
+    }
+    if (value >= 10) {
+        *--p = digit_pairs[value * 2 + 1];
+        *--p = digit_pairs[value * 2];
+    } else {
+        *--p = (char)('0' + value);
+    }
+    size_t n = (size_t)(end - p);
+    memcpy(text, p, n);
+    return n;
+}
+
+// Appends one element, followed by a separator unless it is the last one.
+static inline void out_put_element(OutBuffer* out, uint16_t data, bool separator) {
+    char text[ELEMENT_TEXT_MAX];
+    size_t n = format_u16(text, data);
+    if (separator) {
+        text[n++] = ',';
+        text[n++] = ' ';
+    }
+    if (out->len + n <= out->size) {
+        // Fast path: room left in the buffer.
+        memcpy(out->data + out->len, text, n);
+        out->len += n;
+        out->total += n;
+    } else {
+        out_put(out, text, n);
+    }
+}
+
+// Serializes the elements between two nodes (inclusive) as "[a, b, c]".
+static void out_put_range(OutBuffer* out, Node** head, Node* start_node, Node* end_node) {
+    Node* current = start_node ? start_node : *head;
+
+    out_put(out, "[", 1);
     while (current != NULL) {
-        printf("%u", current->data);
-        if (current->next != NULL) {
-            printf(", ");
+        bool last = current->next == NULL || current == end_node;
+        out_put_element(out, current->data, !last);
+        if (last) {
+            break;
         }
         current = current->next;
     }
-    printf("]");
+    out_put(out, "]", 1);
 }
 
-// Displays elements between two nodes (inclusive).
+// Writes the elements between two nodes (inclusive) to a stream.
+// Output is assembled in a stack buffer and written with a few large fwrite calls.
 // Parameters:
+// - stream: Destination stream.
 // - head: Pointer to the head pointer of the linked list.
 // - start_node: The starting node (inclusive). If NULL, starts from the head.
 // - end_node: The ending node (inclusive). If NULL, goes until the end.
-void list_display_range(Node** head, Node* start_node, Node* end_node) {
-    Node* current = start_node ? start_node : *head;
+void list_fprint_range(FILE* stream, Node** head, Node* start_node, Node* end_node) {
+    char data[DISPLAY_BUFFER_SIZE];
+    OutBuffer out = { data, sizeof(data), 0, 0, stream };
+    out_put_range(&out, head, start_node, end_node);
+    out_flush(&out);
+}
 
-    printf("[");
-    while (current != NULL && (end_node == NULL || current != end_node->next)) {
-        printf("%d", current->data);
-        if (current->next != NULL && current != end_node) {
-            printf(", ");
-        }
-        current = current->next;
+// Serializes the list into a caller-provided buffer as "[a, b, c]".
+// The output is always NUL-terminated and truncated if the buffer is too small.
+// Parameters:
+// - head: Pointer to the head pointer of the linked list.
+// - buffer: Destination buffer.
+// - size: Size of the destination buffer in bytes.
+// Returns:
+// - The length of the full text (excluding the terminator), like snprintf.
+size_t list_to_string(Node** head, char* buffer, size_t size) {
+    if (size == 0) {
+        char none;
+        OutBuffer out = { &none, 0, 0, 0, NULL };
+        out_put_range(&out, head, NULL, NULL);
+        return out.total;
     }
-    printf("]");
+
+    OutBuffer out = { buffer, size - 1, 0, 0, NULL };
+    out_put_range(&out, head, NULL, NULL);
+    buffer[out.len] = '\0';
+    return out.total;
+}
+
+// Displays all elements in the list.
+// Parameters:
+// - head: Pointer to the head pointer of the linked list.
+void list_display(Node** head) {
+    list_fprint_range(stdout, head, NULL, NULL);
+}
+
+// Displays elements between two nodes (inclusive).
+// Parameters:
+// - head: Pointer to the head pointer of the linked list.
+// - start_node: The starting node (inclusive). If NULL, starts from the head.
+// - end_node: The ending node (inclusive). If NULL, goes until the end.
+void list_display_range(Node** head, Node* start_node, Node* end_node) {
+    list_fprint_range(stdout, head, start_node, end_node);
 }
 
 // Counts the number of nodes in the list.
@@ -212,15 +631,1065 @@ int list_count_nodes(Node** head) {
 }
 
 // Frees all nodes in the list and deinitializes the memory manager.
+// The nodes are released chunk by chunk, so no per-node walk is needed.
 // Parameters:
 // - head: Pointer to the head pointer of the linked list.
 void list_cleanup(Node** head) {
-    Node* current = *head;
-    while (current != NULL) {
-        Node* next_node = current->next;
-        mem_free(current);
-        current = next_node;
-    }
     *head = NULL;
-    mem_deinit();
+    node_pools_deinit();
+}
+
+// Prepares an incremental compaction of the list.
+// A fresh region large enough for every node is reserved up front; list_compact_step then
+// moves nodes into it in traversal order.
+// Parameters:
+// - head: Pointer to the head pointer of the linked list.
+// - state: Compaction state to initialize.
+// Returns:
+// - 0 on success, -1 if the memory pool has no contiguous region large enough.
+// Errors:
+// - Prints an error message if the region cannot be reserved.
+int list_compact_begin(Node** head, ListCompaction* state) {
+    size_t count = (size_t)list_count_nodes(head);
+
+    state->head = head;
+    state->region = NULL;
+    state->source = *head;
+    state->last = NULL;
+    state->moved = 0;
+    if (count == 0) {
+        return 0;
+    }
+
+    // Every slot of the region is spoken for by a node that is about to move in.
+    Node* region = (Node*) node_pool_alloc_run(&node_pool, count);
+    if (!region) {
+        printf("Memory allocation failed\n");
+        return -1;
+    }
+
+    state->region = region;
+    return 0;
+}
+
+// Moves up to max_nodes nodes of the list into the compaction region.
+// The list stays valid for traversal between steps, but it must not be modified
+// until the compaction has finished. Node pointers obtained before the compaction
+// are invalidated as their nodes are moved.
+// Parameters:
+// - state: Compaction state prepared by list_compact_begin.
+// - max_nodes: Upper bound on the number of nodes moved by this step.
+// Returns:
+// - true once every node has been moved and the emptied chunks were released.
+bool list_compact_step(ListCompaction* state, size_t max_nodes) {
+    size_t steps = 0;
+    while (state->source != NULL && steps < max_nodes) {
+        Node* source = state->source;
+        Node* target = state->region + state->moved;
+
+        state->source = source->next;
+        target->data = source->data;
+        target->next = source->next;
+        if (state->last == NULL) {
+            *state->head = target;
+        } else {
+            state->last->next = target;
+        }
+        node_pool_release(&node_pool, source);
+
+        state->last = target;
+        state->moved++;
+        steps++;
+    }
+
+    if (state->source != NULL) {
+        return false;
+    }
+    state->region = NULL;
+    node_pool_trim(&node_pool);
+    return true;
+}
+
+// Abandons an incremental compaction before it has finished.
+// The nodes moved so far stay in the region and the list remains valid; the unused tail
+// of the region goes back to the node pool, and chunks emptied by the moved nodes are
+// released. Calling it after the compaction has finished does nothing.
+// Parameters:
+// - state: Compaction state prepared by list_compact_begin.
+void list_compact_abort(ListCompaction* state) {
+    if (state->region == NULL) {
+        return;
+    }
+    size_t index = node_pool_find(&node_pool, state->region);
+    if (index < node_pool.chunk_count) {
+        // No slot of the region has been released yet, so the moved nodes are its prefix.
+        NodeChunk* chunk = &node_pool.chunks[index];
+        chunk->used = state->moved;
+        chunk->live = state->moved;
+        if (!chunk->open) {
+            chunk->open = true;
+            node_pool.open[node_pool.open_count++] = index;
+        }
+    }
+    state->region = NULL;
+    state->source = NULL;
+    node_pool_trim(&node_pool);
+}
+
+// Relocates the nodes of the list into one contiguous region in traversal order and
+// releases the chunks left empty, so that traversal walks memory sequentially.
+// Node pointers obtained before the call are invalidated.
+// Parameters:
+// - head: Pointer to the head pointer of the linked list.
+// Returns:
+// - 0 on success, -1 if the memory pool has no contiguous region large enough.
+int list_compact(Node** head) {
+    ListCompaction state;
+    if (list_compact_begin(head, &state) != 0) {
+        return -1;
+    }
+    list_compact_step(&state, SIZE_MAX);
+    return 0;
+}
+
+// ********* Parallel traversal *********
+
+// Upper bound on the number of threads used by the parallel operations.
+#define PARALLEL_MAX_THREADS 64
+
+// One parallel operation over the segments of a list sample. Workers claim segments
+// through next_segment and write per-segment results, which the caller combines in
+// segment order so the outcome does not depend on scheduling.
+typedef struct ParallelJob {
+    const ListSample* sample;
+    atomic_size_t next_segment;                             // Next unclaimed segment
+    void (*run)(struct ParallelJob* job, size_t segment);   // Per-segment work
+    uint16_t data;                                          // Value searched for
+    ListStats* stats;                                       // Per-segment reduce results
+    size_t* offsets;                                        // Per-segment match counts, then output offsets
+    Node** matches;                                         // Output array of find-all
+    size_t max_matches;                                     // Capacity of matches
+} ParallelJob;
+
+// Claims and processes segments until none are left.
+static void* parallel_worker(void* arg) {
+    ParallelJob* job = (ParallelJob*)arg;
+    size_t segment;
+    while ((segment = atomic_fetch_add(&job->next_segment, 1)) < job->sample->segments) {
+        job->run(job, segment);
+    }
+    return NULL;
+}
+
+// Runs the job on up to threads threads, the calling thread included.
+// Falls back to fewer threads if they cannot be created.
+static void parallel_run(ParallelJob* job, int threads) {
+    pthread_t workers[PARALLEL_MAX_THREADS];
+    int started = 0;
+
+    atomic_store(&job->next_segment, 0);
+    if (threads > PARALLEL_MAX_THREADS) {
+        threads = PARALLEL_MAX_THREADS;
+    }
+    if ((size_t)threads > job->sample->segments) {
+        threads = (int)job->sample->segments;
+    }
+    for (int i = 1; i < threads; i++) {
+        if (pthread_create(&workers[started], NULL, parallel_worker, job) != 0) {
+            break;
+        }
+        started++;
+    }
+    parallel_worker(job);
+    for (int i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+}
+
+// Splits the list into consecutive segments of segment_length nodes (the last one may be
+// shorter). This is a single sequential pass; the sample can then be reused by any number
+// of parallel operations as long as the list is not modified.
+// Parameters:
+// - head: Pointer to the head pointer of the linked list.
+// - segment_length: Number of nodes per segment (0 is treated as 1).
+// - sample: Receives the segment boundaries; release with list_sample_free.
+// Returns:
+// - 0 on success, -1 if the sample arrays cannot be allocated.
+// Errors:
+// - Prints an error message if memory allocation fails.
+int list_sample(Node** head, size_t segment_length, ListSample* sample) {
+    size_t slots = 0;
+    sample->starts = NULL;
+    sample->lengths = NULL;
+    sample->segments = 0;
+    sample->count = 0;
+    if (segment_length == 0) {
+        segment_length = 1;
+    }
+
+    for (Node* current = *head; current != NULL; current = current->next) {
+        if (sample->count % segment_length == 0) {
+            if (sample->segments == slots) {
+                slots = slots ? slots * 2 : 64;
+                Node** starts = (Node**)realloc(sample->starts, slots * sizeof(Node*));
+                size_t* lengths = starts ? (size_t*)realloc(sample->lengths, slots * sizeof(size_t)) : NULL;
+                if (starts) {
+                    sample->starts = starts;
+                }
+                if (!lengths) {
+                    printf("Memory allocation failed\n");
+                    list_sample_free(sample);
+                    return -1;
+                }
+                sample->lengths = lengths;
+            }
+            sample->starts[sample->segments] = current;
+            sample->lengths[sample->segments] = 0;
+            sample->segments++;
+        }
+        sample->lengths[sample->segments - 1]++;
+        sample->count++;
+    }
+    return 0;
+}
+
+// Frees the arrays of a list sample.
+// Parameters:
+// - sample: The sample to release.
+void list_sample_free(ListSample* sample) {
+    free(sample->starts);
+    free(sample->lengths);
+    sample->starts = NULL;
+    sample->lengths = NULL;
+    sample->segments = 0;
+    sample->count = 0;
+}
+
+// Computes the statistics of one segment.
+static void reduce_segment(ParallelJob* job, size_t segment) {
+    ListStats stats = { 0, 0, UINT16_MAX, 0 };
+    Node* current = job->sample->starts[segment];
+    for (size_t i = job->sample->lengths[segment]; i > 0; i--) {
+        uint16_t value = current->data;
+        stats.sum += value;
+        stats.min = value < stats.min ? value : stats.min;
+        stats.max = value > stats.max ? value : stats.max;
+        current = current->next;
+    }
+    stats.count = job->sample->lengths[segment];
+    job->stats[segment] = stats;
+}
+
+// Computes count, sum, min and max over the sampled list in parallel.
+// Parameters:
+// - sample: Segment boundaries produced by list_sample.
+// - threads: Number of threads to use, including the caller.
+// Returns:
+// - The statistics of the whole list.
+// Errors:
+// - Prints an error message and falls back to one pass on the calling thread if
+//   the per-segment results cannot be allocated.
+ListStats list_parallel_reduce(const ListSample* sample, int threads) {
+    ListStats total = { 0, 0, UINT16_MAX, 0 };
+    ListStats single;
+    ParallelJob job = { .sample = sample, .run = reduce_segment };
+
+    job.stats = (ListStats*)malloc(sample->segments * sizeof(ListStats));
+    if (!job.stats) {
+        printf("Memory allocation failed\n");
+        job.stats = &single;
+        for (size_t segment = 0; segment < sample->segments; segment++) {
+            reduce_segment(&job, segment);
+            total.count += single.count;
+            total.sum += single.sum;
+            total.min = single.min < total.min ? single.min : total.min;
+            total.max = single.max > total.max ? single.max : total.max;
+        }
+        return total;
+    }
+
+    parallel_run(&job, threads);
+    for (size_t segment = 0; segment < sample->segments; segment++) {
+        ListStats* stats = &job.stats[segment];
+        total.count += stats->count;
+        total.sum += stats->sum;
+        total.min = stats->min < total.min ? stats->min : total.min;
+        total.max = stats->max > total.max ? stats->max : total.max;
+    }
+    free(job.stats);
+    return total;
+}
+
+// Counts the matches of one segment (first phase of find-all).
+static void count_matches_segment(ParallelJob* job, size_t segment) {
+    size_t matches = 0;
+    Node* current = job->sample->starts[segment];
+    for (size_t i = job->sample->lengths[segment]; i > 0; i--) {
+        matches += current->data == job->data;
+        current = current->next;
+    }
+    job->offsets[segment] = matches;
+}
+
+// Stores the matches of one segment at its output offset (second phase of find-all).
+static void store_matches_segment(ParallelJob* job, size_t segment) {
+    size_t offset = job->offsets[segment];
+    Node* current = job->sample->starts[segment];
+    for (size_t i = job->sample->lengths[segment]; i > 0 && offset < job->max_matches; i--) {
+        if (current->data == job->data) {
+            job->matches[offset++] = current;
+        }
+        current = current->next;
+    }
+}
+
+// Finds every node holding a value, in parallel. Matches are counted per segment,
+// turned into output offsets, and then stored, so they always come out in list order.
+// Parameters:
+// - sample: Segment boundaries produced by list_sample.
+// - threads: Number of threads to use, including the caller.
+// - data: The value to search for.
+// - matches: Output array for the matching nodes (may be NULL if max_matches is 0).
+// - max_matches: Capacity of matches; further matches are counted but not stored.
+// Returns:
+// - The total number of matches.
+// Errors:
+// - Prints an error message and returns 0 if the per-segment offsets cannot be allocated.
+size_t list_parallel_find_all(const ListSample* sample, int threads, uint16_t data, Node** matches, size_t max_matches) {
+    ParallelJob job = { .sample = sample, .run = count_matches_segment, .data = data,
+                        .matches = matches, .max_matches = max_matches };
+
+    job.offsets = (size_t*)malloc(sample->segments * sizeof(size_t));
+    if (!job.offsets) {
+        printf("Memory allocation failed\n");
+        return 0;
+    }
+    parallel_run(&job, threads);
+
+    size_t total = 0;
+    for (size_t segment = 0; segment < sample->segments; segment++) {
+        size_t count = job.offsets[segment];
+        job.offsets[segment] = total;
+        total += count;
+    }
+
+    if (max_matches > 0 && total > 0) {
+        job.run = store_matches_segment;
+        parallel_run(&job, threads);
+    }
+    free(job.offsets);
+    return total;
+}
+
+// ********* Binary persistence *********
+
+// Identifies list files written by list_save.
+#define LIST_FILE_MAGIC "LLST"
+#define LIST_FILE_VERSION 1
+
+// Number of values staged per write call by list_save.
+#define LIST_SAVE_BATCH 4096
+
+// Header of a list file; the packed uint16_t values follow it directly.
+typedef struct ListFileHeader {
+    char magic[4];        // LIST_FILE_MAGIC
+    uint16_t version;     // LIST_FILE_VERSION
+    uint16_t byte_order;  // 0x0102 as written by the saving host
+    uint64_t count;       // Number of values
+} ListFileHeader;
+
+// Writes the whole buffer to fd, retrying on partial writes and on writes interrupted
+// by a signal.
+// Returns:
+// - 0 on success, -1 on a write error.
+static int write_all(int fd, const void* data, size_t size) {
+    const char* p = (const char*)data;
+    while (size > 0) {
+        ssize_t written = write(fd, p, size);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written < 0) {
+            return -1;
+        }
+        p += written;
+        size -= (size_t)written;
+    }
+    return 0;
+}
+
+// Writes the list to a file descriptor in a compact binary format: a header with
+// the element count followed by the values as a packed uint16_t array.
+// Parameters:
+// - head: Pointer to the head pointer of the linked list.
+// - fd: File descriptor of an empty file open for writing (list_load maps from offset 0).
+// Returns:
+// - 0 on success, -1 on a write error.
+// Errors:
+// - Prints an error message if writing fails.
+int list_save(Node** head, int fd) {
+    ListFileHeader header = { LIST_FILE_MAGIC, LIST_FILE_VERSION, 0x0102, (uint64_t)list_count_nodes(head) };
+    if (write_all(fd, &header, sizeof(header)) != 0) {
+        perror("list_save");
+        return -1;
+    }
+
+    uint16_t batch[LIST_SAVE_BATCH];
+    size_t n = 0;
+    for (Node* current = *head; current != NULL; current = current->next) {
+        batch[n++] = current->data;
+        if (n == LIST_SAVE_BATCH || current->next == NULL) {
+            if (write_all(fd, batch, n * sizeof(uint16_t)) != 0) {
+                perror("list_save");
+                return -1;
+            }
+            n = 0;
+        }
+    }
+    return 0;
+}
+
+// Maps a file written by list_save and returns zero-copy, read-only access to its values.
+// Parameters:
+// - fd: File descriptor of the list file, open for reading.
+// - count: Receives the number of values.
+// - map_size: Receives the length of the mapping, the whole file, which may extend past
+//   the values; pass it to list_unmap_values.
+// Returns:
+// - A pointer to the packed values (release with list_unmap_values), or NULL on error.
+// Errors:
+// - Prints an error message if the file cannot be mapped or is not a valid list file.
+const uint16_t* list_map_values(int fd, size_t* count, size_t* map_size) {
+    struct stat st;
+    *count = 0;
+    *map_size = 0;
+    if (fstat(fd, &st) != 0) {
+        perror("list_map_values");
+        return NULL;
+    }
+    if ((size_t)st.st_size < sizeof(ListFileHeader)) {
+        printf("Invalid list file\n");
+        return NULL;
+    }
+
+    void* map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        perror("list_map_values");
+        return NULL;
+    }
+
+    const ListFileHeader* header = (const ListFileHeader*)map;
+    if (memcmp(header->magic, LIST_FILE_MAGIC, 4) != 0 || header->version != LIST_FILE_VERSION ||
+        header->byte_order != 0x0102 ||
+        header->count > ((size_t)st.st_size - sizeof(ListFileHeader)) / sizeof(uint16_t)) {
+        printf("Invalid list file\n");
+        munmap(map, (size_t)st.st_size);
+        return NULL;
+    }
+    // Hint the kernel that the values are about to be read front to back.
+    madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+    *count = (size_t)header->count;
+    *map_size = (size_t)st.st_size;
+    return (const uint16_t*)(header + 1);
+}
+
+// Releases a mapping obtained from list_map_values.
+// Parameters:
+// - values: Pointer returned by list_map_values (NULL is ignored).
+// - map_size: Length of the mapping reported by list_map_values.
+void list_unmap_values(const uint16_t* values, size_t map_size) {
+    if (values) {
+        munmap((char*)values - sizeof(ListFileHeader), map_size);
+    }
+}
+
+// Loads a file written by list_save and appends its values to the list.
+// The file is mapped rather than read, and all nodes are carved from a single
+// contiguous run of the node pool, so there is no per-node allocation.
+// Parameters:
+// - head: Pointer to the head pointer of the linked list.
+// - fd: File descriptor of the list file, open for reading.
+// Returns:
+// - The number of values loaded, or -1 on error.
+// Errors:
+// - Prints an error message if the file is invalid or the memory pool is too small.
+long list_load(Node** head, int fd) {
+    size_t count;
+    size_t map_size;
+    const uint16_t* values = list_map_values(fd, &count, &map_size);
+    if (!values) {
+        return -1;
+    }
+    if (count == 0) {
+        list_unmap_values(values, map_size);
+        return 0;
+    }
+
+    Node* nodes = (Node*) node_pool_alloc_run(&node_pool, count);
+    if (!nodes) {
+        printf("Memory allocation failed\n");
+        list_unmap_values(values, map_size);
+        return -1;
+    }
+    for (size_t i = 0; i < count; i++) {
+        nodes[i].data = values[i];
+        nodes[i].next = &nodes[i + 1];
+    }
+    nodes[count - 1].next = NULL;
+    list_unmap_values(values, map_size);
+
+    if (*head == NULL) {
+        *head = nodes;
+    } else {
+        Node* tail = *head;
+        while (tail->next != NULL) {
+            tail = tail->next;
+        }
+        tail->next = nodes;
+    }
+    return (long)count;
+}
+
+// ********* Compressed list mode *********
+
+// Converts a compact link into a node pointer.
+static inline CNode* cnode_at(uint32_t offset) {
+    return offset == CNODE_NIL ? NULL : (CNode*)(cnode_base + offset);
+}
+
+// Converts a node pointer into a compact link.
+static inline uint32_t cnode_offset(const CNode* node) {
+    return node == NULL ? CNODE_NIL : (uint32_t)((const char*)node - cnode_base);
+}
+
+// Initializes a compact list and the custom memory manager.
+// Parameters:
+// - head: Pointer to the head pointer of the compact list.
+// - size: Size of the memory pool to be initialized.
+// Errors:
+// - Prints an error and exits if the pool is too large for 32-bit links.
+void clist_init(CNode** head, size_t size) {
+    if (size >= CNODE_NIL) {
+        fprintf(stderr, "Compact list pool must be smaller than 4 GiB\n");
+        exit(EXIT_FAILURE);
+    }
+    *head = NULL;
+    node_pools_init(size);
+    cnode_base = (char*)mem_pool_base();
+}
+
+// Returns the node following the given one.
+// Parameters:
+// - node: A node of a compact list.
+// Returns:
+// - The next node, or NULL at the end of the list.
+CNode* clist_next(const CNode* node) {
+    return cnode_at(node->next);
+}
+
+// Inserts a new node at the end of the compact list.
+// Parameters:
+// - head: Pointer to the head pointer of the compact list.
+// - data: The data to be inserted into the new node.
+// Errors:
+// - Prints an error message if memory allocation fails.
+void clist_insert(CNode** head, uint16_t data) {
+    CNode* new_node = (CNode*) node_pool_alloc(&cnode_pool);
+    if (!new_node) {
+        printf("Memory allocation failed\n");
+        return;
+    }
+    new_node->data = data;
+    new_node->next = CNODE_NIL;
+
+    if (*head == NULL) {
+        *head = new_node;
+    } else {
+        CNode* current = *head;
+        while (current->next != CNODE_NIL) {
+            current = cnode_at(current->next);
+        }
+        current->next = cnode_offset(new_node);
+    }
+}
+
+// Inserts a new node immediately after a given node of a compact list.
+// Parameters:
+// - prev_node: The node after which the new node should be inserted.
+// - data: The data to be inserted into the new node.
+// Errors:
+// - Prints an error if the previous node is NULL.
+// - Prints an error message if memory allocation fails.
+void clist_insert_after(CNode* prev_node, uint16_t data) {
+    if (prev_node == NULL) {
+        printf("Previous node cannot be NULL\n");
+        return;
+    }
+
+    CNode* new_node = (CNode*) node_pool_alloc(&cnode_pool);
+    if (!new_node) {
+        printf("Memory allocation failed\n");
+        return;
+    }
+    new_node->data = data;
+    new_node->next = prev_node->next;
+    prev_node->next = cnode_offset(new_node);
+}
+
+// Deletes the first node with the specified data from a compact list.
+// Parameters:
+// - head: Pointer to the head pointer of the compact list.
+// - data: The data of the node to be deleted.
+// Errors:
+// - Prints an error if the list is empty.
+// - Prints an error if the data is not found in the list.
+void clist_delete(CNode** head, uint16_t data) {
+    if (*head == NULL) {
+        printf("List is empty\n");
+        return;
+    }
+
+    CNode* current = *head;
+    CNode* previous = NULL;
+
+    while (current != NULL && current->data != data) {
+        previous = current;
+        current = cnode_at(current->next);
+    }
+
+    if (current == NULL) {
+        printf("Data not found in the list\n");
+        return;
+    }
+
+    if (previous == NULL) {
+        *head = cnode_at(current->next);
+    } else {
+        previous->next = current->next;
+    }
+
+    node_pool_release(&cnode_pool, current);
+}
+
+// Searches a compact list for a node with the specified data.
+// Parameters:
+// - head: Pointer to the head pointer of the compact list.
+// - data: The data to search for.
+// Returns:
+// - A pointer to the node containing the data if found, otherwise NULL.
+CNode* clist_search(CNode** head, uint16_t data) {
+    CNode* current = *head;
+    while (current != NULL) {
+        if (current->data == data) {
+            return current;
+        }
+        current = cnode_at(current->next);
+    }
+    return NULL;
+}
+
+// Displays all elements in a compact list.
+// Parameters:
+// - head: Pointer to the head pointer of the compact list.
+void clist_display(CNode** head) {
+    char data[DISPLAY_BUFFER_SIZE];
+    OutBuffer out = { data, sizeof(data), 0, 0, stdout };
+    CNode* current = *head;
+
+    out_put(&out, "[", 1);
+    while (current != NULL) {
+        out_put_element(&out, current->data, current->next != CNODE_NIL);
+        current = cnode_at(current->next);
+    }
+    out_put(&out, "]", 1);
+    out_flush(&out);
+}
+
+// Counts the number of nodes in a compact list.
+// Parameters:
+// - head: Pointer to the head pointer of the compact list.
+// Returns:
+// - The total number of nodes in the list.
+int clist_count_nodes(CNode** head) {
+    if (*head == NULL) {
+        return 0;
+    }
+    int count = 1;
+    uint32_t link = (*head)->next;
+    while (link != CNODE_NIL) {
+        count++;
+        link = cnode_at(link)->next;
+    }
+    return count;
+}
+
+// Frees all nodes in the compact list and deinitializes the memory manager.
+// Parameters:
+// - head: Pointer to the head pointer of the compact list.
+void clist_cleanup(CNode** head) {
+    *head = NULL;
+    cnode_base = NULL;
+    node_pools_deinit();
+}
+
+// ********* Sorted list with skip-list acceleration *********
+
+// Draws the number of express lanes for a new node: each lane is kept with
+// probability 1/4, which bounds the overlay to about a third of the node count.
+static int skiplist_random_level(SkipList* list) {
+    // xorshift32
+    uint32_t x = list->seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    list->seed = x;
+
+    int level = 0;
+    while (level < SKIP_MAX_LEVEL && (x & 3) == 0) {
+        level++;
+        x >>= 2;
+    }
+    return level;
+}
+
+// Walks the express lanes towards the last entries with a value below data.
+// Parameters:
+// - list: The skip list.
+// - data: The value being looked for.
+// - update: If not NULL, receives the last entry below data on every lane (NULL when
+//   the lane has none).
+// Returns:
+// - The last base node with a value below data, or NULL if there is none.
+static Node* skiplist_find_before(SkipList* list, uint16_t data, SkipIndex** update) {
+    SkipIndex* current = NULL;
+    for (int level = list->levels - 1; level >= 0; level--) {
+        SkipIndex* next = current ? current->right : list->lanes[level];
+        while (next != NULL && next->node->data < data) {
+            current = next;
+            next = next->right;
+        }
+        if (update) {
+            update[level] = current;
+        }
+        if (level > 0 && current) {
+            current = current->down;
+        }
+    }
+
+    Node* before = current ? current->node : NULL;
+    Node* next = before ? before->next : list->head;
+    while (next != NULL && next->data < data) {
+        before = next;
+        next = next->next;
+    }
+    return before;
+}
+
+// Initializes an empty skip list and the custom memory manager.
+// Parameters:
+// - list: The skip list to initialize.
+// - size: Size of the memory pool to be initialized.
+void skiplist_init(SkipList* list, size_t size) {
+    list->head = NULL;
+    for (int i = 0; i < SKIP_MAX_LEVEL; i++) {
+        list->lanes[i] = NULL;
+    }
+    list->levels = 0;
+    list->seed = 2463534242u;
+    node_pools_init(size);
+}
+
+// Inserts a value in front of the first node with a value not below it, and
+// promotes the new node to a random number of express lanes.
+// Parameters:
+// - list: The skip list.
+// - data: The value to insert.
+// Errors:
+// - Prints an error message if memory allocation fails.
+void skiplist_insert(SkipList* list, uint16_t data) {
+    SkipIndex* update[SKIP_MAX_LEVEL];
+    int level = skiplist_random_level(list);
+    for (int i = list->levels; i < level; i++) {
+        update[i] = NULL;
+    }
+
+    Node* before = skiplist_find_before(list, data, update);
+    Node* new_node = (Node*) node_pool_alloc(&node_pool);
+    if (!new_node) {
+        printf("Memory allocation failed\n");
+        return;
+    }
+    new_node->data = data;
+    if (before == NULL) {
+        new_node->next = list->head;
+        list->head = new_node;
+    } else {
+        new_node->next = before->next;
+        before->next = new_node;
+    }
+
+    // Express lanes are best effort: a node missing from a lane only costs speed.
+    SkipIndex* below = NULL;
+    for (int i = 0; i < level; i++) {
+        SkipIndex* entry = (SkipIndex*) node_pool_alloc(&index_pool);
+        if (!entry) {
+            break;
+        }
+        entry->node = new_node;
+        entry->down = below;
+        if (update[i] == NULL) {
+            entry->right = list->lanes[i];
+            list->lanes[i] = entry;
+        } else {
+            entry->right = update[i]->right;
+            update[i]->right = entry;
+        }
+        below = entry;
+        if (i >= list->levels) {
+            list->levels = i + 1;
+        }
+    }
+}
+
+// Finds the first node with a value not below data.
+// Parameters:
+// - list: The skip list.
+// - data: The lower bound.
+// Returns:
+// - The first node with a value >= data, or NULL if every value is smaller.
+Node* skiplist_lower_bound(SkipList* list, uint16_t data) {
+    Node* before = skiplist_find_before(list, data, NULL);
+    return before ? before->next : list->head;
+}
+
+// Searches the skip list for a value.
+// Parameters:
+// - list: The skip list.
+// - data: The value to search for.
+// Returns:
+// - The first node holding the value, or NULL if it is not in the list.
+Node* skiplist_search(SkipList* list, uint16_t data) {
+    Node* node = skiplist_lower_bound(list, data);
+    return node != NULL && node->data == data ? node : NULL;
+}
+
+// Deletes the first node with the specified value and its express-lane entries.
+// Parameters:
+// - list: The skip list.
+// - data: The value of the node to be deleted.
+// Errors:
+// - Prints an error if the list is empty.
+// - Prints an error if the value is not found in the list.
+void skiplist_delete(SkipList* list, uint16_t data) {
+    if (list->head == NULL) {
+        printf("List is empty\n");
+        return;
+    }
+
+    SkipIndex* update[SKIP_MAX_LEVEL];
+    Node* before = skiplist_find_before(list, data, update);
+    Node* target = before ? before->next : list->head;
+    if (target == NULL || target->data != data) {
+        printf("Data not found in the list\n");
+        return;
+    }
+
+    // The target is the first node with its value, so on every lane where it is
+    // indexed its entry directly follows the last entry below the value.
+    for (int level = list->levels - 1; level >= 0; level--) {
+        SkipIndex** link = update[level] ? &update[level]->right : &list->lanes[level];
+        SkipIndex* entry = *link;
+        if (entry != NULL && entry->node == target) {
+            *link = entry->right;
+            node_pool_release(&index_pool, entry);
+        }
+    }
+    while (list->levels > 0 && list->lanes[list->levels - 1] == NULL) {
+        list->levels--;
+    }
+
+    if (before == NULL) {
+        list->head = target->next;
+    } else {
+        before->next = target->next;
+    }
+    node_pool_release(&node_pool, target);
+}
+
+// Displays the values within [low, high] in ascending order.
+// Parameters:
+// - list: The skip list.
+// - low: Smallest value to display.
+// - high: Largest value to display.
+void skiplist_display_range(SkipList* list, uint16_t low, uint16_t high) {
+    char data[DISPLAY_BUFFER_SIZE];
+    OutBuffer out = { data, sizeof(data), 0, 0, stdout };
+    Node* current = low <= high ? skiplist_lower_bound(list, low) : NULL;
+
+    out_put(&out, "[", 1);
+    while (current != NULL && current->data <= high) {
+        bool last = current->next == NULL || current->next->data > high;
+        out_put_element(&out, current->data, !last);
+        current = current->next;
+    }
+    out_put(&out, "]", 1);
+    out_flush(&out);
+}
+
+// Frees all nodes and express-lane entries and deinitializes the memory manager.
+// Parameters:
+// - list: The skip list.
+void skiplist_cleanup(SkipList* list) {
+    list->head = NULL;
+    for (int i = 0; i < SKIP_MAX_LEVEL; i++) {
+        list->lanes[i] = NULL;
+    }
+    list->levels = 0;
+    node_pools_deinit();
+}
+
+// ********* Concurrent list *********
+
+// Walks the list with hand-over-hand locking up to the first node whose value is not
+// below data. On return pred and *curr (if not NULL) are both locked.
+// Returns:
+// - The locked predecessor of *curr.
+static LockedNode* concurrent_list_locate(ConcurrentList* list, uint16_t data, LockedNode** curr) {
+    LockedNode* pred = &list->head;
+    pthread_mutex_lock(&pred->lock);
+    LockedNode* node = pred->next;
+    if (node) {
+        pthread_mutex_lock(&node->lock);
+    }
+    while (node != NULL && node->data < data) {
+        pthread_mutex_unlock(&pred->lock);
+        pred = node;
+        node = node->next;
+        if (node) {
+            pthread_mutex_lock(&node->lock);
+        }
+    }
+    *curr = node;
+    return pred;
+}
+
+// Releases the locks taken by concurrent_list_locate.
+static inline void concurrent_list_unlock(LockedNode* pred, LockedNode* curr) {
+    if (curr) {
+        pthread_mutex_unlock(&curr->lock);
+    }
+    pthread_mutex_unlock(&pred->lock);
+}
+
+// Initializes an empty concurrent list and the custom memory manager.
+// Parameters:
+// - list: The list to initialize.
+// - size: Size of the memory pool to be initialized.
+void concurrent_list_init(ConcurrentList* list, size_t size) {
+    list->head.data = 0;
+    list->head.next = NULL;
+    pthread_mutex_init(&list->head.lock, NULL);
+    node_pools_init(size);
+}
+
+// Inserts a value in front of the first node with a value not below it.
+// Parameters:
+// - list: The concurrent list.
+// - data: The value to insert.
+// Returns:
+// - true on success, false if memory allocation fails.
+// Errors:
+// - Prints an error message if memory allocation fails.
+bool concurrent_list_insert(ConcurrentList* list, uint16_t data) {
+    // Allocate before taking any list lock to keep the critical sections short.
+    LockedNode* new_node = (LockedNode*) mem_alloc(sizeof(LockedNode));
+    if (!new_node) {
+        printf("Memory allocation failed\n");
+        return false;
+    }
+    new_node->data = data;
+    pthread_mutex_init(&new_node->lock, NULL);
+
+    LockedNode* curr;
+    LockedNode* pred = concurrent_list_locate(list, data, &curr);
+    new_node->next = curr;
+    pred->next = new_node;
+    concurrent_list_unlock(pred, curr);
+    return true;
+}
+
+// Deletes the first node with the specified value.
+// Parameters:
+// - list: The concurrent list.
+// - data: The value of the node to be deleted.
+// Returns:
+// - true if a node was deleted, false if the value is not in the list.
+bool concurrent_list_delete(ConcurrentList* list, uint16_t data) {
+    LockedNode* curr;
+    LockedNode* pred = concurrent_list_locate(list, data, &curr);
+    if (curr == NULL || curr->data != data) {
+        concurrent_list_unlock(pred, curr);
+        return false;
+    }
+
+    pred->next = curr->next;
+    concurrent_list_unlock(pred, curr);
+
+    // Any other thread reaches curr only through pred's lock, which we held while
+    // unlinking it, so nobody can still be holding or waiting for curr.
+    pthread_mutex_destroy(&curr->lock);
+    mem_free(curr);
+    return true;
+}
+
+// Checks whether a value is in the list.
+// Parameters:
+// - list: The concurrent list.
+// - data: The value to search for.
+// Returns:
+// - true if a node holds the value, otherwise false.
+bool concurrent_list_contains(ConcurrentList* list, uint16_t data) {
+    LockedNode* curr;
+    LockedNode* pred = concurrent_list_locate(list, data, &curr);
+    bool found = curr != NULL && curr->data == data;
+    concurrent_list_unlock(pred, curr);
+    return found;
+}
+
+// Counts the number of nodes in the list.
+// Parameters:
+// - list: The concurrent list.
+// Returns:
+// - The number of nodes at the time each of them was visited.
+int concurrent_list_count_nodes(ConcurrentList* list) {
+    int count = 0;
+    LockedNode* pred = &list->head;
+    pthread_mutex_lock(&pred->lock);
+    LockedNode* node = pred->next;
+    while (node != NULL) {
+        pthread_mutex_lock(&node->lock);
+        pthread_mutex_unlock(&pred->lock);
+        count++;
+        pred = node;
+        node = node->next;
+    }
+    pthread_mutex_unlock(&pred->lock);
+    return count;
+}
+
+// Frees all nodes and deinitializes the memory manager.
+// The node memory goes away with the pool, so nodes are only walked to destroy their locks.
+// Must not run concurrently with any other operation on the list.
+// Parameters:
+// - list: The concurrent list.
+void concurrent_list_cleanup(ConcurrentList* list) {
+    LockedNode* current = list->head.next;
+    while (current != NULL) {
+        LockedNode* next = current->next;
+        pthread_mutex_destroy(&current->lock);
+        current = next;
+    }
+    list->head.next = NULL;
+    pthread_mutex_destroy(&list->head.lock);
+    node_pools_deinit();
 }
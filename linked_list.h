@@ -4,6 +4,8 @@
 #include <stdint.h> // For uint16_t
 #include <stdbool.h> // For bool
 #include <stddef.h>  // Defines size_t
+#include <stdio.h>   // For FILE
+#include <pthread.h> // For pthread_mutex_t
 
 
 // Node structure for the singly linked list
@@ -12,25 +14,104 @@ typedef struct Node {
     struct Node* next;  // Pointer to the next node
 } Node;
 
+// Link value marking the end of a compact list
+#define CNODE_NIL UINT32_MAX
+
+// Compact node for the compressed list mode. The link is a 32-bit byte offset
+// from the memory pool base instead of a pointer, so a node takes 8 bytes
+// (6 bytes when built with -DLIST_PACKED_CNODE) instead of 16.
+#ifdef LIST_PACKED_CNODE
+typedef struct __attribute__((packed)) CNode {
+#else
+typedef struct CNode {
+#endif
+    uint16_t data;      // Stores the data (16-bit unsigned integer)
+    uint32_t next;      // Offset of the next node from the pool base, or CNODE_NIL
+} CNode;
+
+// Maximum number of express lanes in a skip list
+#define SKIP_MAX_LEVEL 16
+
+// Express-lane entry of a skip list. Each entry indexes one node of the base list;
+// entries on the same lane are linked by right, and down leads to the entry of the
+// same node one lane below (NULL on the lowest lane).
+typedef struct SkipIndex {
+    Node* node;                 // Indexed node of the base list
+    struct SkipIndex* right;    // Next entry on the same lane
+    struct SkipIndex* down;     // Entry for the same node on the lane below
+} SkipIndex;
+
+// Sorted list with a probabilistic skip-list overlay. The base list is an ordinary
+// sorted Node list, so every read-only list_* function can be used on &list->head.
+typedef struct SkipList {
+    Node* head;                         // Base level, sorted by value
+    SkipIndex* lanes[SKIP_MAX_LEVEL];   // First entry of every express lane
+    int levels;                         // Number of lanes in use
+    uint32_t seed;                      // State of the level generator
+} SkipList;
+
+// Node of a concurrent list, protected by its own lock
+typedef struct LockedNode {
+    uint16_t data;              // Stores the data (16-bit unsigned integer)
+    struct LockedNode* next;    // Pointer to the next node
+    pthread_mutex_t lock;       // Guards next and the node's membership in the list
+} LockedNode;
+
+// Sorted list that several threads may modify at once. Operations use hand-over-hand
+// locking: a thread holds at most two adjacent node locks, so operations on different
+// parts of the list proceed in parallel.
+typedef struct ConcurrentList {
+    LockedNode head;            // Sentinel; the first element is head.next
+} ConcurrentList;
+
+// Segment boundaries of a list, sampled once and reused by the parallel operations.
+// The sample is valid until the list is modified.
+typedef struct ListSample {
+    Node** starts;      // First node of every segment
+    size_t* lengths;    // Number of nodes in every segment
+    size_t segments;    // Number of segments
+    size_t count;       // Total number of nodes
+} ListSample;
+
+// Result of list_parallel_reduce
+typedef struct ListStats {
+    size_t count;       // Number of nodes
+    uint64_t sum;       // Sum of all values
+    uint16_t min;       // Smallest value (UINT16_MAX for an empty list)
+    uint16_t max;       // Largest value (0 for an empty list)
+} ListStats;
+
+// State of an incremental list compaction (see list_compact_begin)
+typedef struct ListCompaction {
+    Node** head;        // List being compacted
+    Node* region;       // Contiguous destination region
+    Node* source;       // Next node to move
+    Node* last;         // Last node moved into the region
+    size_t moved;       // Number of nodes moved so far
+} ListCompaction;
+
 // Function declarations for linked list operations
 
 // Initializes the linked list by setting the head to NULL
 void list_init(Node** head, size_t size);
 
 // Inserts a new node with the specified data at the end of the list
-void list_insert(Node** head, int data);
+void list_insert(Node** head, uint16_t data);
 
 // Inserts a new node with the specified data immediately after the given node
-void list_insert_after(Node* prev_node, int data);
+void list_insert_after(Node* prev_node, uint16_t data);
 
 // Inserts a new node with the specified data immediately before the given node
-void list_insert_before(Node** head, Node* next_node, int data);
+void list_insert_before(Node** head, Node* next_node, uint16_t data);
+
+// Inserts a new node keeping an ascending list sorted
+void list_insert_sorted(Node** head, uint16_t data);
 
 // Deletes a node with the specified data from the list
-void list_delete(Node** head, int data);
+void list_delete(Node** head, uint16_t data);
 
 // Searches for a node with the specified data in the list
-Node* list_search(Node** head, int data);
+Node* list_search(Node** head, uint16_t data);
 
 // Displays all the nodes in the list
 void list_display(Node** head);
@@ -38,10 +119,126 @@ void list_display(Node** head);
 // Displays nodes within a specific range
 void list_display_range(Node** head, Node* start_node, Node* end_node);
 
+// Writes nodes within a specific range to a stream using buffered output
+void list_fprint_range(FILE* stream, Node** head, Node* start_node, Node* end_node);
+
+// Serializes the list into buffer (NUL-terminated, truncated if needed); returns the full length
+size_t list_to_string(Node** head, char* buffer, size_t size);
+
 // Counts the number of nodes in the list
 int list_count_nodes(Node** head);
 
 // Frees all nodes in the list and sets the head pointer to NULL
 void list_cleanup(Node** head);
 
+// Writes the list to fd as a header followed by a packed uint16_t array
+int list_save(Node** head, int fd);
+
+// Appends the values of a file written by list_save; returns the number loaded or -1
+long list_load(Node** head, int fd);
+
+// Maps a list file and returns read-only access to its packed values (zero-copy)
+const uint16_t* list_map_values(int fd, size_t* count, size_t* map_size);
+
+// Releases a mapping obtained from list_map_values, of map_size bytes
+void list_unmap_values(const uint16_t* values, size_t map_size);
+
+// Splits the list into segments of segment_length nodes for the parallel operations
+int list_sample(Node** head, size_t segment_length, ListSample* sample);
+
+// Frees the arrays of a list sample
+void list_sample_free(ListSample* sample);
+
+// Computes count, sum, min and max over the sampled list using up to threads threads
+ListStats list_parallel_reduce(const ListSample* sample, int threads);
+
+// Stores up to max_matches nodes holding data, in list order; returns the total number of matches
+size_t list_parallel_find_all(const ListSample* sample, int threads, uint16_t data, Node** matches, size_t max_matches);
+
+// Relocates the nodes into one contiguous region in traversal order (invalidates node pointers)
+int list_compact(Node** head);
+
+// Starts an incremental compaction; the list must not be modified until it finishes
+int list_compact_begin(Node** head, ListCompaction* state);
+
+// Moves up to max_nodes nodes; returns true once the compaction has finished
+bool list_compact_step(ListCompaction* state, size_t max_nodes);
+
+// Abandons an unfinished compaction, keeping the nodes moved so far and returning the rest of the region
+void list_compact_abort(ListCompaction* state);
+
+// Sorted list with skip-list acceleration: O(log n) expected insert, search and delete.
+// The base list must only be modified through the skiplist_* functions.
+
+// Initializes a skip list and the memory manager
+void skiplist_init(SkipList* list, size_t size);
+
+// Inserts a value keeping the list sorted
+void skiplist_insert(SkipList* list, uint16_t data);
+
+// Deletes the first node with the specified value
+void skiplist_delete(SkipList* list, uint16_t data);
+
+// Returns the first node with the specified value, or NULL
+Node* skiplist_search(SkipList* list, uint16_t data);
+
+// Returns the first node with a value >= data, or NULL
+Node* skiplist_lower_bound(SkipList* list, uint16_t data);
+
+// Displays the values within [low, high]
+void skiplist_display_range(SkipList* list, uint16_t low, uint16_t high);
+
+// Frees all nodes and express lanes and deinitializes the memory manager
+void skiplist_cleanup(SkipList* list);
+
+// Concurrent list: safe to call from several threads at once (except init and cleanup).
+// Nodes are allocated with mem_alloc, whose thread-safe path they rely on.
+
+// Initializes a concurrent list and the memory manager
+void concurrent_list_init(ConcurrentList* list, size_t size);
+
+// Inserts a value keeping the list sorted; returns false if allocation fails
+bool concurrent_list_insert(ConcurrentList* list, uint16_t data);
+
+// Deletes the first node with the specified value; returns false if it is not found
+bool concurrent_list_delete(ConcurrentList* list, uint16_t data);
+
+// Returns true if the value is in the list
+bool concurrent_list_contains(ConcurrentList* list, uint16_t data);
+
+// Counts the number of nodes in the list
+int concurrent_list_count_nodes(ConcurrentList* list);
+
+// Frees all nodes and deinitializes the memory manager
+void concurrent_list_cleanup(ConcurrentList* list);
+
+// Compressed list mode: same operations on CNode lists. The memory pool must not exceed 4 GiB.
+
+// Initializes a compact list and the memory manager
+void clist_init(CNode** head, size_t size);
+
+// Inserts a new node with the specified data at the end of the compact list
+void clist_insert(CNode** head, uint16_t data);
+
+// Inserts a new node with the specified data immediately after the given node
+void clist_insert_after(CNode* prev_node, uint16_t data);
+
+// Deletes the first node with the specified data from the compact list
+void clist_delete(CNode** head, uint16_t data);
+
+// Searches for a node with the specified data in the compact list
+CNode* clist_search(CNode** head, uint16_t data);
+
+// Returns the node following the given one, or NULL at the end of the list
+CNode* clist_next(const CNode* node);
+
+// Displays all the nodes in the compact list
+void clist_display(CNode** head);
+
+// Counts the number of nodes in the compact list
+int clist_count_nodes(CNode** head);
+
+// Frees all nodes in the compact list and sets the head pointer to NULL
+void clist_cleanup(CNode** head);
+
 #endif // LINKED_LIST_H
@@ -1,179 +1,3380 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <stddef.h>
 #include <string.h>
 #include <errno.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include "memory_manager.h"
+#include "memory_manager_classes.h"
+#include "memory_manager_inline.h"
 
-// Structure to represent a memory block in the pool
-typedef struct Block {
-    size_t size;           // Size of the block
-    int is_free;           // 1 if the block is free, 0 if it is allocated
-    struct Block* next;    // Pointer to the next block
-    void* ptr;             // Pointer to the memory within the pool
-} Block;
+// Index of a block descriptor in its pool's block table
+typedef uint32_t BlockId;
+#define BLOCK_NIL UINT32_MAX
 
-void* memory_pool = NULL;  // Pointer to the start of the memory pool
-Block* head_block = NULL;  // Head of the linked list of memory blocks
-size_t memory_pool_size = 0;
+// Descriptors of the memory blocks of a pool, as a struct of arrays indexed by BlockId.
+// A walk of the block list only touches the flag, link and size arrays, which pack many
+// more blocks per cache line than whole descriptors would. The arrays share one mapping
+// reserved when the pool is set up, each starting on its own cache line. Unused
+// descriptors are recycled through a free list threaded through next, so taking and
+// returning a descriptor is O(1) and never calls malloc.
+typedef struct BlockTable {
+    uint8_t* is_free;      // 1 if the block is free, 0 if it is allocated
+    BlockId* next;         // Next block in address order (next spare for recycled descriptors)
+    size_t* size;          // Size of the block
+    size_t* offset;        // Offset of the block's memory from the pool base
+    size_t* clean;         // Free blocks: offset from which the memory is known to be zero
+    BlockId* left;         // Free blocks under best/worst fit: smaller (size, address) subtree
+    BlockId* right;        // Free blocks under best/worst fit: larger (size, address) subtree
+    uint32_t* handle;      // Allocated blocks: handle owning the block (mem_handle_alloc), or 0
+    BlockId capacity;      // Number of descriptors the arrays hold
+    BlockId used;          // Descriptors handed out at least once
+    BlockId spare;         // Head of the list of recycled descriptors
+    void* mapping;         // The mapping holding all arrays
+    size_t mapping_size;   // Size of the mapping in bytes
+    bool fixed;            // The arrays live in a pool file (mem_init_file) and cannot grow
+} BlockTable;
+
+// Allocation bitmaps of a bitmap pool (mem_init_bitmap), one bit per granule each.
+typedef struct Bitmap {
+    uint64_t* used;        // Bit set: the granule is allocated
+    uint64_t* last;        // Bit set: the granule is the last one of an allocated block
+    size_t granules;       // Number of granules in the pool
+    size_t words;          // Number of words in each bitmap
+    size_t hint;           // Every word of used before this one is full
+    void* mapping;         // The mapping holding both bitmaps
+    size_t mapping_size;   // Size of the mapping in bytes
+} Bitmap;
+
+// A contiguous region of memory managed as an address-ordered list of blocks, or as a
+// bitmap of fixed-size granules
+typedef struct Pool {
+    char* base;            // Start of the pool memory
+    size_t size;           // Size of the pool in bytes
+    BlockTable blocks;     // Descriptors of the blocks
+    BlockId head;          // First block of the pool
+    int node;              // NUMA node the pool serves (0 for a plain pool)
+    int memory_node;       // Node the pages are bound to (differs from node in a fake topology)
+    bool mapped;           // true if base comes from mmap rather than malloc
+    MemPolicy policy;      // Placement policy
+    BlockId rover;         // Next fit: block the previous search ended at
+    BlockId tree;          // Best/worst fit: root of the treap of the free blocks
+    uint64_t free_classes; // Bit c set: some free block has a size class of c (see size_log2)
+    uint32_t free_class_count[64]; // Number of free blocks of every size class
+    size_t largest_free;   // No free block is larger; exact again after a failed search
+    size_t granule;        // Bitmap pools: allocation unit in bytes; 0 for block list pools
+    Bitmap bitmap;         // Bitmap pools: the allocation bitmaps
+    struct PoolFile* file; // File pools: the header at the start of the file mapping, else NULL
+    int file_fd;           // Persistent pools: the file, kept open for the flock marking it in use
+    bool shared;           // Shared pools: locked through the file, which holds the state
+    MemLifetime lifetime;  // MEM_SHORT_LIVED: a sub-pool serving only short-lived requests
+    size_t live_blocks;    // Allocated blocks, for short-lived sub-pools (file pools do not keep it)
+    pthread_mutex_t lock;  // Serializes block operations on this pool
+} Pool;
+
+// Free blocks of at least this many dirty bytes in a mapped pool are returned to the
+// kernel with MADV_DONTNEED, after which they read back as zero.
+#define PURGE_MIN_BYTES (128 * 1024)
+
+#define CACHE_LINE 64
+
+// Descriptors reserved per byte of pool: one per BLOCK_TABLE_GRANULE bytes, a realistic
+// average block size. With 41 bytes per descriptor the reserve is about 16% of the pool,
+// and the mapping is made with MAP_NORESERVE, so only the part actually used is backed
+// by memory. A pool cut into smaller blocks than that on average makes the table grow
+// by doubling.
+#define BLOCK_TABLE_GRANULE 256
+#define BLOCK_TABLE_MIN 64
+
+// Largest number of pools, and so of NUMA nodes, mem_init_numa sets up.
+#define MAX_POOLS 64
+
+// mem_init sets up pools[0]; mem_init_numa sets up one pool per NUMA node and mem_grow
+// appends pools while the allocator is in use. Each pool has its own lock, so threads
+// allocating on different nodes do not contend.
+static Pool pools[MAX_POOLS] = { [0 ... MAX_POOLS - 1] = { .lock = PTHREAD_MUTEX_INITIALIZER } };
+static atomic_int pool_count = 0;
+static pthread_mutex_t grow_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Placement policy of pools set up from now on (mem_set_policy).
+static atomic_int default_policy = MEM_FIRST_FIT;
+
+// Incremented by mem_init and mem_deinit so thread caches can tell that the pool they
+// were filled from is gone. Exported for the inline fast paths (memory_manager_inline.h).
+atomic_uint mem_pool_generation = 0;
+
+// Pool the calling thread allocates from, valid while numa_self_generation matches.
+static __thread int numa_self = 0;
+static __thread unsigned numa_self_generation = 0;
+
+static inline size_t cache_round(size_t bytes) {
+    return (bytes + CACHE_LINE - 1) & ~(size_t)(CACHE_LINE - 1);
+}
+
+// Returns the number of bytes the arrays of a table of capacity descriptors take.
+static size_t table_bytes(BlockId capacity) {
+    size_t flags_bytes = cache_round(capacity * sizeof(uint8_t));
+    size_t id_bytes = cache_round(capacity * sizeof(BlockId));
+    size_t size_bytes = cache_round(capacity * sizeof(size_t));
+    return flags_bytes + 4 * id_bytes + 3 * size_bytes;
+}
+
+// Points the arrays of a table of capacity descriptors into memory at mapping, which
+// holds table_bytes(capacity) bytes; used and spare are left alone.
+static void table_place(BlockTable* table, char* mapping, BlockId capacity) {
+    size_t flags_bytes = cache_round(capacity * sizeof(uint8_t));
+    size_t id_bytes = cache_round(capacity * sizeof(BlockId));
+    size_t size_bytes = cache_round(capacity * sizeof(size_t));
+
+    // Hot arrays first: a list walk reads is_free, next and size
+    char* p = mapping;
+    table->is_free = (uint8_t*)p;
+    p += flags_bytes;
+    table->next = (BlockId*)p;
+    p += id_bytes;
+    table->size = (size_t*)p;
+    p += size_bytes;
+    table->offset = (size_t*)p;
+    p += size_bytes;
+    table->clean = (size_t*)p;
+    p += size_bytes;
+    table->left = (BlockId*)p;
+    p += id_bytes;
+    table->right = (BlockId*)p;
+    p += id_bytes;
+    table->handle = (uint32_t*)p;
+
+    table->capacity = capacity;
+    table->mapping = mapping;
+    table->mapping_size = table_bytes(capacity);
+}
+
+// Maps the arrays of a table of capacity descriptors; used and spare are left alone.
+// Returns:
+// - true on success, false with errno set if the mapping fails.
+static bool table_map(BlockTable* table, BlockId capacity) {
+    size_t total = table_bytes(capacity);
+    char* mapping = (char*)mmap(NULL, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    table_place(table, mapping, capacity);
+    table->fixed = false;
+    return true;
+}
+
+// Doubles the capacity of a full table, moving the descriptors to a new mapping.
+// Returns:
+// - true on success, false with errno set if the table cannot grow.
+static bool table_grow(BlockTable* table) {
+    if (table->fixed || table->capacity >= BLOCK_NIL / 2) {
+        errno = ENOMEM;
+        return false;
+    }
+    BlockTable old = *table;
+    if (!table_map(table, old.capacity * 2)) {
+        return false;
+    }
+    memcpy(table->is_free, old.is_free, old.used * sizeof(uint8_t));
+    memcpy(table->next, old.next, old.used * sizeof(BlockId));
+    memcpy(table->size, old.size, old.used * sizeof(size_t));
+    memcpy(table->offset, old.offset, old.used * sizeof(size_t));
+    memcpy(table->clean, old.clean, old.used * sizeof(size_t));
+    memcpy(table->left, old.left, old.used * sizeof(BlockId));
+    memcpy(table->right, old.right, old.used * sizeof(BlockId));
+    memcpy(table->handle, old.handle, old.used * sizeof(uint32_t));
+    munmap(old.mapping, old.mapping_size);
+    return true;
+}
+
+// Takes a block descriptor, recycling a returned one if there is any (caller holds
+// pool->lock, or owns the pool during setup).
+// Returns:
+// - The descriptor, or BLOCK_NIL with errno set if the table is full and cannot grow.
+static BlockId block_new(Pool* pool) {
+    BlockTable* table = &pool->blocks;
+    BlockId id = table->spare;
+    if (id != BLOCK_NIL) {
+        table->spare = table->next[id];
+    } else if (table->used < table->capacity || table_grow(table)) {
+        id = table->used++;
+    } else {
+        return BLOCK_NIL;
+    }
+    table->handle[id] = 0;
+    return id;
+}
+
+// Returns a block descriptor for reuse (caller holds pool->lock).
+static void block_delete(Pool* pool, BlockId id) {
+    pool->blocks.next[id] = pool->blocks.spare;
+    pool->blocks.spare = id;
+}
+
+// Returns the memory of a block.
+static inline char* block_ptr(const Pool* pool, BlockId id) {
+    return pool->base + pool->blocks.offset[id];
+}
+
+// Returns the block starting at ptr, or BLOCK_NIL if there is none (caller holds pool->lock).
+static BlockId block_at(const Pool* pool, const void* ptr) {
+    const BlockTable* t = &pool->blocks;
+    size_t offset = (size_t)((const char*)ptr - pool->base);
+    for (BlockId id = pool->head; id != BLOCK_NIL && t->offset[id] <= offset; id = t->next[id]) {
+        if (t->offset[id] == offset) {
+            return id;
+        }
+    }
+    return BLOCK_NIL;
+}
+
+// ********* Free block tree (best and worst fit) *********
+
+// Under best and worst fit every free block of a pool is also kept in a treap ordered by
+// (size, address), so both policies find their block in O(log n) expected time. The heap
+// priority is a hash of the block address, which keeps the shape independent of the
+// order in which blocks are freed.
+
+static inline uint32_t tree_priority(const BlockTable* t, BlockId id) {
+    return (uint32_t)(((uint64_t)t->offset[id] * 0x9E3779B97F4A7C15ULL) >> 32);
+}
+
+static inline bool tree_less(const BlockTable* t, BlockId a, BlockId b) {
+    return t->size[a] < t->size[b] || (t->size[a] == t->size[b] && t->offset[a] < t->offset[b]);
+}
+
+static inline bool pool_uses_tree(const Pool* pool) {
+    return pool->policy == MEM_BEST_FIT || pool->policy == MEM_WORST_FIT;
+}
+
+// Inserts a block into the subtree at root and returns the new subtree root.
+static BlockId tree_insert(BlockTable* t, BlockId root, BlockId id) {
+    if (root == BLOCK_NIL) {
+        t->left[id] = BLOCK_NIL;
+        t->right[id] = BLOCK_NIL;
+        return id;
+    }
+    if (tree_less(t, id, root)) {
+        t->left[root] = tree_insert(t, t->left[root], id);
+        if (tree_priority(t, t->left[root]) > tree_priority(t, root)) {
+            BlockId left = t->left[root];
+            t->left[root] = t->right[left];
+            t->right[left] = root;
+            return left;
+        }
+    } else {
+        t->right[root] = tree_insert(t, t->right[root], id);
+        if (tree_priority(t, t->right[root]) > tree_priority(t, root)) {
+            BlockId right = t->right[root];
+            t->right[root] = t->left[right];
+            t->left[right] = root;
+            return right;
+        }
+    }
+    return root;
+}
+
+// Joins two subtrees where every block of a orders before every block of b.
+static BlockId tree_join(BlockTable* t, BlockId a, BlockId b) {
+    if (a == BLOCK_NIL) {
+        return b;
+    }
+    if (b == BLOCK_NIL) {
+        return a;
+    }
+    if (tree_priority(t, a) > tree_priority(t, b)) {
+        t->right[a] = tree_join(t, t->right[a], b);
+        return a;
+    }
+    t->left[b] = tree_join(t, a, t->left[b]);
+    return b;
+}
+
+// Removes a block from the subtree at root and returns the new subtree root.
+static BlockId tree_remove(BlockTable* t, BlockId root, BlockId id) {
+    if (root == BLOCK_NIL) {
+        return BLOCK_NIL;
+    }
+    if (root == id) {
+        return tree_join(t, t->left[id], t->right[id]);
+    }
+    if (tree_less(t, id, root)) {
+        t->left[root] = tree_remove(t, t->left[root], id);
+    } else {
+        t->right[root] = tree_remove(t, t->right[root], id);
+    }
+    return root;
+}
+
+// Size class of a free block: floor(log2(size)), with 0 for empty blocks.
+static inline unsigned size_log2(size_t size) {
+    return size ? 63 - (unsigned)__builtin_clzll(size) : 0;
+}
+
+// Adds a free block to the pool's tree when the policy uses one, and to the size
+// summary (caller holds pool->lock).
+static void free_index_insert(Pool* pool, BlockId id) {
+    size_t size = pool->blocks.size[id];
+    unsigned size_class = size_log2(size);
+    pool->free_class_count[size_class]++;
+    pool->free_classes |= 1ULL << size_class;
+    if (size > pool->largest_free) {
+        pool->largest_free = size;
+    }
+    if (pool_uses_tree(pool)) {
+        pool->tree = tree_insert(&pool->blocks, pool->tree, id);
+    }
+}
+
+// Removes a free block from the pool's tree when the policy uses one, and from the size
+// summary (caller holds pool->lock). largest_free is left as an upper bound.
+static void free_index_remove(Pool* pool, BlockId id) {
+    unsigned size_class = size_log2(pool->blocks.size[id]);
+    if (--pool->free_class_count[size_class] == 0) {
+        pool->free_classes &= ~(1ULL << size_class);
+    }
+    if (pool_uses_tree(pool)) {
+        pool->tree = tree_remove(&pool->blocks, pool->tree, id);
+    }
+}
+
+// Tells in O(1) whether some free block may hold size bytes (caller holds pool->lock).
+// A false answer is exact: no free block is in a size class that could hold size bytes,
+// or size exceeds the largest free block.
+static inline bool pool_may_fit(const Pool* pool, size_t size) {
+    if (pool->free_classes == 0 || size > pool->largest_free) {
+        return false;
+    }
+    unsigned top = size_log2(pool->free_classes);
+    return top == 63 || size < (1ULL << (top + 1));
+}
+
+// Sets largest_free to the exact size of the largest free block (caller holds pool->lock).
+static void pool_refresh_largest(Pool* pool) {
+    const BlockTable* t = &pool->blocks;
+    size_t largest = 0;
+    if (pool_uses_tree(pool)) {
+        BlockId id = pool->tree;
+        while (id != BLOCK_NIL && t->right[id] != BLOCK_NIL) {
+            id = t->right[id];
+        }
+        largest = id != BLOCK_NIL ? t->size[id] : 0;
+    } else {
+        for (BlockId id = pool->head; id != BLOCK_NIL; id = t->next[id]) {
+            if (t->is_free[id] && t->size[id] > largest) {
+                largest = t->size[id];
+            }
+        }
+    }
+    pool->largest_free = largest;
+}
+
+// Returns a free block of at least size bytes chosen by the pool's placement policy, or
+// BLOCK_NIL if there is none (caller holds pool->lock).
+static BlockId block_search(Pool* pool, size_t size) {
+    const BlockTable* t = &pool->blocks;
+    switch (pool->policy) {
+    case MEM_NEXT_FIT: {
+        // Resume where the previous search ended and wrap around once
+        BlockId start = pool->rover != BLOCK_NIL ? pool->rover : pool->head;
+        for (int pass = 0; pass < 2; pass++) {
+            BlockId stop = pass == 0 ? BLOCK_NIL : start;
+            for (BlockId id = pass == 0 ? start : pool->head; id != stop; id = t->next[id]) {
+                if (t->is_free[id] && t->size[id] >= size) {
+                    pool->rover = id;
+                    return id;
+                }
+            }
+        }
+        return BLOCK_NIL;
+    }
+    case MEM_BEST_FIT: {
+        // Smallest block that fits; the lowest address among equal sizes
+        BlockId best = BLOCK_NIL;
+        for (BlockId id = pool->tree; id != BLOCK_NIL;) {
+            if (t->size[id] >= size) {
+                best = id;
+                id = t->left[id];
+            } else {
+                id = t->right[id];
+            }
+        }
+        return best;
+    }
+    case MEM_WORST_FIT: {
+        BlockId largest = pool->tree;
+        while (largest != BLOCK_NIL && t->right[largest] != BLOCK_NIL) {
+            largest = t->right[largest];
+        }
+        return largest != BLOCK_NIL && t->size[largest] >= size ? largest : BLOCK_NIL;
+    }
+    default: {
+        // Find the first free block that is large enough
+        for (BlockId id = pool->head; id != BLOCK_NIL; id = t->next[id]) {
+            if (t->is_free[id] && t->size[id] >= size) {
+                return id;
+            }
+        }
+        return BLOCK_NIL;
+    }
+    }
+}
+
+// Like block_search, but rejects requests no free block can hold without a walk. A
+// failed search makes largest_free exact, so the next request that is too large for the
+// pool is turned away in O(1) as well (caller holds pool->lock).
+static BlockId block_find(Pool* pool, size_t size) {
+    if (!pool_may_fit(pool, size)) {
+        return BLOCK_NIL;
+    }
+    BlockId id = block_search(pool, size);
+    if (id == BLOCK_NIL) {
+        pool_refresh_largest(pool);
+    }
+    return id;
+}
+
+// Switches a pool to a placement policy, building or dropping its free block tree (caller
+// holds pool->lock).
+static void pool_set_policy(Pool* pool, MemPolicy policy) {
+    pool->tree = BLOCK_NIL;
+    pool->rover = BLOCK_NIL;
+    pool->policy = policy;
+    pool->free_classes = 0;
+    pool->largest_free = 0;
+    memset(pool->free_class_count, 0, sizeof(pool->free_class_count));
+    for (BlockId id = pool->head; id != BLOCK_NIL; id = pool->blocks.next[id]) {
+        if (pool->blocks.is_free[id]) {
+            free_index_insert(pool, id);
+        }
+    }
+}
+
+// Returns the number of descriptors reserved for a pool of size bytes.
+static BlockId table_capacity(size_t size) {
+    size_t capacity = size / BLOCK_TABLE_GRANULE + BLOCK_TABLE_MIN;
+    return capacity > BLOCK_NIL / 2 ? BLOCK_NIL / 2 : (BlockId)capacity;
+}
+
+// Makes a pool with a placed, empty block table cover size bytes at base as a single
+// free block; zeroed tells whether the memory is known to be zero (freshly mapped or
+// calloc'd).
+static void pool_format(Pool* pool, void* base, size_t size, bool zeroed, int node, int memory_node, bool mapped) {
+    pool->blocks.used = 0;
+    pool->blocks.spare = BLOCK_NIL;
+
+    // The initial block covers the entire pool
+    BlockId head = block_new(pool);
+    BlockTable* t = &pool->blocks;
+    t->size[head] = size;      // The size of the entire pool
+    t->is_free[head] = 1;      // The entire pool is initially free
+    t->offset[head] = 0;       // Starts at the start of the pool
+    t->next[head] = BLOCK_NIL;
+    t->clean[head] = zeroed ? 0 : size;
+
+    pool->base = (char*)base;
+    pool->size = size;
+    pool->granule = 0;
+    pool->head = head;
+    pool->node = node;
+    pool->memory_node = memory_node;
+    pool->mapped = mapped;
+    pool->file = NULL;
+    pool->shared = false;
+    pool->lifetime = MEM_LONG_LIVED;
+    pool->live_blocks = 0;
+    pool_set_policy(pool, (MemPolicy)atomic_load(&default_policy));
+}
+
+// Sets up a pool covering size bytes at base as a single free block, as pool_format
+// does. The block table is reserved here, so block operations on the pool need no
+// further allocation as long as its blocks average at least BLOCK_TABLE_GRANULE bytes.
+// Returns:
+// - true on success, false with errno set if the block table cannot be mapped.
+static bool pool_setup(Pool* pool, void* base, size_t size, bool zeroed, int node, int memory_node, bool mapped) {
+    if (!table_map(&pool->blocks, table_capacity(size))) {
+        return false;
+    }
+    pool_format(pool, base, size, zeroed, node, memory_node, mapped);
+    return true;
+}
+
+// Returns the pool whose memory contains ptr, or NULL.
+static Pool* pool_of(const void* ptr) {
+    int count = atomic_load(&pool_count);
+    for (int i = 0; i < count; i++) {
+        if ((const char*)ptr >= pools[i].base && (const char*)ptr < pools[i].base + pools[i].size) {
+            return &pools[i];
+        }
+    }
+    return NULL;
+}
+
+// Returns the index of the pool serving a NUMA node, or 0 if there is none.
+static int numa_pool_index(int node) {
+    int count = atomic_load(&pool_count);
+    for (int i = 0; i < count; i++) {
+        if (pools[i].node == node) {
+            return i;
+        }
+    }
+    return 0;
+}
+
+// Returns the NUMA node the calling thread is running on (0 if it cannot be determined).
+static int numa_current_node(void) {
+    unsigned cpu = 0;
+    unsigned node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0) {
+        return 0;
+    }
+    return (int)node;
+}
+
+// Returns the index of the pool the calling thread allocates from first. The node is
+// looked up once per thread and pool generation; mem_numa_set_node overrides it.
+static int pool_local(void) {
+    if (atomic_load_explicit(&pool_count, memory_order_relaxed) <= 1) {
+        return 0;
+    }
+    unsigned generation = atomic_load_explicit(&mem_pool_generation, memory_order_relaxed);
+    if (numa_self_generation != generation) {
+        numa_self = numa_pool_index(numa_current_node());
+        numa_self_generation = generation;
+    }
+    return numa_self;
+}
 
 // Initializes the memory pool with the specified size
 // Parameters:
-// - size: the size of the memory pool to allocate.
+// - size: the size of the memory pool to allocate.
+// Errors:
+// - Prints an error message and exits if memory allocation fails.
+void mem_init(size_t size) {
+    // calloc gets large pools straight from mmap without touching them, and lets
+    // mem_calloc skip zeroing memory the pool has not handed out yet
+    void* base = calloc(1, size);
+    if (!base) {
+        perror("Memory pool allocation failed");
+        exit(EXIT_FAILURE);
+    }
+
+    if (!pool_setup(&pools[0], base, size, true, 0, 0, false)) {
+        perror("Block metadata allocation failed");
+        free(base);
+        exit(EXIT_FAILURE);
+    }
+    atomic_store(&pool_count, 1);
+    atomic_fetch_add(&mem_pool_generation, 1);
+}
+
+// ********* Bitmap pools *********
+
+// A bitmap pool hands out whole granules and keeps two bits per granule instead of a
+// descriptor per block: used marks allocated granules and last marks the final granule
+// of every allocation, so a block's extent is found from its start by one scan for the
+// next last bit. Free runs are found with word scans and count-trailing-zeros, skipping
+// fully allocated words four at a time.
+
+#define BITMAP_WORD_BITS 64
+
+static inline bool bitmap_test(const uint64_t* map, size_t bit) {
+    return (map[bit / BITMAP_WORD_BITS] >> (bit % BITMAP_WORD_BITS)) & 1;
+}
+
+// Sets (value true) or clears count bits starting at start.
+static void bitmap_fill(uint64_t* map, size_t start, size_t count, bool value) {
+    while (count > 0) {
+        size_t word = start / BITMAP_WORD_BITS;
+        size_t shift = start % BITMAP_WORD_BITS;
+        size_t bits = BITMAP_WORD_BITS - shift < count ? BITMAP_WORD_BITS - shift : count;
+        uint64_t mask = (bits == BITMAP_WORD_BITS ? ~0ULL : ((1ULL << bits) - 1)) << shift;
+        map[word] = value ? map[word] | mask : map[word] & ~mask;
+        start += bits;
+        count -= bits;
+    }
+}
+
+// Returns the first bit at or after from that equals value, or limit if there is none
+// before limit.
+static size_t bitmap_next(const uint64_t* map, size_t from, size_t limit, bool value) {
+    if (from >= limit) {
+        return limit;
+    }
+    uint64_t flip = value ? 0 : ~0ULL;
+    size_t word = from / BITMAP_WORD_BITS;
+    size_t last_word = (limit - 1) / BITMAP_WORD_BITS;
+    uint64_t bits = (map[word] ^ flip) & (~0ULL << (from % BITMAP_WORD_BITS));
+    while (bits == 0) {
+        if (++word > last_word) {
+            return limit;
+        }
+        // Looking for a free granule: skip runs of fully allocated words
+        if (!value) {
+            while (word + 4 <= last_word && (map[word] & map[word + 1] & map[word + 2] & map[word + 3]) == ~0ULL) {
+                word += 4;
+            }
+        }
+        bits = map[word] ^ flip;
+    }
+    size_t bit = word * BITMAP_WORD_BITS + (size_t)__builtin_ctzll(bits);
+    return bit < limit ? bit : limit;
+}
+
+// Returns the number of granules a request of size bytes takes; zero-byte requests take one.
+static inline size_t bitmap_granules(const Pool* pool, size_t size) {
+    return size == 0 ? 1 : size / pool->granule + (size % pool->granule != 0);
+}
+
+// Finds count free granules in a row whose first granule index is congruent to phase
+// modulo step (step 1 for no alignment), lowest address first (caller holds pool->lock).
+// Returns:
+// - The first granule of the run, or SIZE_MAX if there is none.
+static size_t bitmap_find(Pool* pool, size_t count, size_t step, size_t phase) {
+    Bitmap* bitmap = &pool->bitmap;
+    size_t granules = bitmap->granules;
+    size_t g = bitmap_next(bitmap->used, bitmap->hint * BITMAP_WORD_BITS, granules, false);
+    // Every word before the first free granule is full
+    bitmap->hint = g / BITMAP_WORD_BITS;
+    while (g < granules) {
+        g += (phase + step - g % step) % step;
+        if (g >= granules || count > granules - g) {
+            break;
+        }
+        size_t end = bitmap_next(bitmap->used, g, g + count, true);
+        if (end == g + count) {
+            return g;
+        }
+        g = bitmap_next(bitmap->used, end, granules, false);
+    }
+    return SIZE_MAX;
+}
+
+// Marks count granules from start allocated as one block and returns its memory.
+static void* bitmap_take(Pool* pool, size_t start, size_t count) {
+    bitmap_fill(pool->bitmap.used, start, count, true);
+    bitmap_fill(pool->bitmap.last, start + count - 1, 1, true);
+    return pool->base + start * pool->granule;
+}
+
+// Allocates a block of whole granules (caller holds pool->lock).
+static void* bitmap_alloc(Pool* pool, size_t size) {
+    if (size > pool->size) {
+        return NULL;
+    }
+    size_t count = bitmap_granules(pool, size);
+    size_t start = bitmap_find(pool, count, 1, 0);
+    return start == SIZE_MAX ? NULL : bitmap_take(pool, start, count);
+}
+
+// Allocates a block whose address is a multiple of alignment (caller holds pool->lock).
+static void* bitmap_alloc_aligned(Pool* pool, size_t alignment, size_t size) {
+    uintptr_t base = (uintptr_t)pool->base;
+    if (size > pool->size || (alignment < pool->granule && base % alignment != 0)) {
+        return NULL;
+    }
+    size_t count = bitmap_granules(pool, size);
+    size_t step = alignment > pool->granule ? alignment / pool->granule : 1;
+    size_t phase = ((((base + alignment - 1) & ~(uintptr_t)(alignment - 1)) - base) / pool->granule) % step;
+    size_t start = bitmap_find(pool, count, step, phase);
+    return start == SIZE_MAX ? NULL : bitmap_take(pool, start, count);
+}
+
+// Carves count adjacent blocks of size bytes out of one free run (caller holds pool->lock).
+// Returns:
+// - true on success, false if no free run is large enough.
+static bool bitmap_alloc_run(Pool* pool, size_t size, size_t count, void** out) {
+    size_t per_block = bitmap_granules(pool, size);
+    if (count > pool->bitmap.granules / per_block) {
+        return false;
+    }
+    size_t start = bitmap_find(pool, per_block * count, 1, 0);
+    if (start == SIZE_MAX) {
+        return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+        out[i] = bitmap_take(pool, start + i * per_block, per_block);
+    }
+    return true;
+}
+
+// Returns the first granule of the allocated block starting at ptr, or SIZE_MAX after
+// printing a warning if there is none.
+static size_t bitmap_block_of(const Pool* pool, const void* ptr, bool quiet) {
+    const Bitmap* bitmap = &pool->bitmap;
+    size_t offset = (size_t)((const char*)ptr - pool->base);
+    size_t g = offset / pool->granule;
+    if (offset % pool->granule != 0 || g >= bitmap->granules ||
+        (g > 0 && bitmap_test(bitmap->used, g - 1) && !bitmap_test(bitmap->last, g - 1) && bitmap_test(bitmap->used, g))) {
+        if (!quiet) {
+            fprintf(stderr, "Warning: Pointer %p not found in the memory pool.\n", ptr);
+        }
+        return SIZE_MAX;
+    }
+    if (!bitmap_test(bitmap->used, g)) {
+        if (!quiet) {
+            fprintf(stderr, "Warning: Attempted to free an already freed block at %p.\n", ptr);
+        }
+        return SIZE_MAX;
+    }
+    return g;
+}
+
+// Returns the number of granules of the block starting at granule start.
+static inline size_t bitmap_extent(const Pool* pool, size_t start) {
+    return bitmap_next(pool->bitmap.last, start, pool->bitmap.granules, true) - start + 1;
+}
+
+// Frees a block by clearing its bits (caller holds pool->lock).
+static void bitmap_free(Pool* pool, void* ptr) {
+    if (!ptr) {
+        fprintf(stderr, "Warning: Attempted to free a NULL pointer.\n");
+        return;
+    }
+    size_t start = bitmap_block_of(pool, ptr, false);
+    if (start == SIZE_MAX) {
+        return;
+    }
+    size_t count = bitmap_extent(pool, start);
+    bitmap_fill(pool->bitmap.used, start, count, false);
+    bitmap_fill(pool->bitmap.last, start + count - 1, 1, false);
+    if (start / BITMAP_WORD_BITS < pool->bitmap.hint) {
+        pool->bitmap.hint = start / BITMAP_WORD_BITS;
+    }
+}
+
+// Resizes a block, growing it in place when the granules after it are free (caller holds
+// pool->lock).
+static void* bitmap_resize(Pool* pool, void* ptr, size_t size) {
+    if (!ptr) return bitmap_alloc(pool, size);
+
+    size_t start = bitmap_block_of(pool, ptr, true);
+    if (start == SIZE_MAX) {
+        fprintf(stderr, "Warning: Pointer %p not found for resizing.\n", ptr);
+        return NULL;
+    }
+    size_t count = bitmap_extent(pool, start);
+    if (size <= count * pool->granule) {
+        return ptr;
+    }
+    size_t needed = size > pool->size ? SIZE_MAX : bitmap_granules(pool, size);
+    if (needed <= pool->bitmap.granules - start &&
+        bitmap_next(pool->bitmap.used, start + count, start + needed, true) == start + needed) {
+        bitmap_fill(pool->bitmap.last, start + count - 1, 1, false);
+        bitmap_fill(pool->bitmap.used, start + count, needed - count, true);
+        bitmap_fill(pool->bitmap.last, start + needed - 1, 1, true);
+        return ptr;
+    }
+    void* new_ptr = bitmap_alloc(pool, size);
+    if (new_ptr) {
+        memcpy(new_ptr, ptr, count * pool->granule);
+        bitmap_free(pool, ptr);
+    }
+    return new_ptr;
+}
+
+// Returns the size of the allocated block at ptr, or 0 (caller holds pool->lock).
+static size_t bitmap_usable_size(const Pool* pool, const void* ptr) {
+    size_t start = bitmap_block_of(pool, ptr, true);
+    return start == SIZE_MAX ? 0 : bitmap_extent(pool, start) * pool->granule;
+}
+
+// Adds the pool's free runs and allocated blocks to stats (caller holds pool->lock).
+static void bitmap_stats(const Pool* pool, MemStats* stats) {
+    const Bitmap* bitmap = &pool->bitmap;
+    for (size_t w = 0; w < bitmap->words; w++) {
+        stats->used_blocks += (size_t)__builtin_popcountll(bitmap->last[w]);
+        stats->used_bytes += (size_t)__builtin_popcountll(bitmap->used[w]) * pool->granule;
+    }
+    // Padding bits past the last granule are marked used
+    stats->used_bytes -= (bitmap->words * BITMAP_WORD_BITS - bitmap->granules) * pool->granule;
+
+    size_t g = bitmap_next(bitmap->used, 0, bitmap->granules, false);
+    while (g < bitmap->granules) {
+        size_t end = bitmap_next(bitmap->used, g, bitmap->granules, true);
+        size_t bytes = (end - g) * pool->granule;
+        stats->free_bytes += bytes;
+        stats->free_blocks++;
+        if (bytes > stats->largest_free) {
+            stats->largest_free = bytes;
+        }
+        g = bitmap_next(bitmap->used, end, bitmap->granules, false);
+    }
+}
+
+// Sets up a pool of size bytes at base as a bitmap pool of granule-byte granules.
+// Returns:
+// - true on success, false with errno set if the bitmaps cannot be mapped.
+static bool bitmap_setup(Pool* pool, void* base, size_t size, size_t granule) {
+    Bitmap* bitmap = &pool->bitmap;
+    bitmap->granules = size / granule;
+    bitmap->words = (bitmap->granules + BITMAP_WORD_BITS - 1) / BITMAP_WORD_BITS;
+    size_t map_bytes = cache_round(bitmap->words * sizeof(uint64_t));
+    bitmap->mapping_size = 2 * map_bytes;
+    char* mapping = (char*)mmap(NULL, bitmap->mapping_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    bitmap->mapping = mapping;
+    bitmap->used = (uint64_t*)mapping;
+    bitmap->last = (uint64_t*)(mapping + map_bytes);
+    bitmap->hint = 0;
+    // Bits past the last granule look allocated, so searches never hand them out
+    size_t tail = bitmap->words * BITMAP_WORD_BITS - bitmap->granules;
+    if (tail > 0) {
+        bitmap_fill(bitmap->used, bitmap->granules, tail, true);
+    }
+
+    pool->base = (char*)base;
+    pool->size = size;
+    pool->granule = granule;
+    pool->head = BLOCK_NIL;
+    pool->rover = BLOCK_NIL;
+    pool->tree = BLOCK_NIL;
+    pool->node = 0;
+    pool->memory_node = 0;
+    pool->mapped = true;
+    pool->file = NULL;
+    pool->shared = false;
+    pool->policy = MEM_FIRST_FIT;
+    return true;
+}
+
+// Initializes the memory pool as a bitmap pool
+// Every allocation is rounded up to whole granules, which are tracked with two bits each
+// instead of a block descriptor per allocation. Allocation takes the lowest-addressed
+// run of free granules that fits, whatever the placement policy; freeing clears the
+// block's bits and never has to merge neighbours.
+// Parameters:
+// - size: the size of the memory pool; a partial granule at the end is not used.
+// - granule: the allocation unit in bytes, a power of two.
+// Errors:
+// - Prints an error message and exits if granule is invalid or memory allocation fails.
+void mem_init_bitmap(size_t size, size_t granule) {
+    if (granule == 0 || (granule & (granule - 1)) != 0 || size < granule) {
+        fprintf(stderr, "Error: Bitmap pool granule %zu is not a power of two no larger than the pool.\n", granule);
+        exit(EXIT_FAILURE);
+    }
+    void* base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        perror("Memory pool allocation failed");
+        exit(EXIT_FAILURE);
+    }
+    if (!bitmap_setup(&pools[0], base, size, granule)) {
+        perror("Bitmap allocation failed");
+        munmap(base, size);
+        exit(EXIT_FAILURE);
+    }
+    atomic_store(&pool_count, 1);
+    atomic_fetch_add(&mem_pool_generation, 1);
+}
+
+// ********* Pool files: persistent and shared pools *********
+
+// mem_init_file and mem_init_shared keep the pool and all of its bookkeeping in one
+// file mapped with MAP_SHARED: a header page, the block table, then the pool memory. The
+// table refers to blocks by index and to memory by offset from the pool base, so the
+// file works wherever it is mapped; the header records where each part starts.
+//
+// A persistent pool (mem_init_file) belongs to one process at a time, which holds an
+// flock on the file while it is open; the kernel drops the lock when that process dies.
+// mem_deinit saves the pool's state in the header, and the next process to map the file
+// finds every block and root object where they were left. A file whose open
+// flag is still set although no one holds the lock lost its owner without mem_deinit;
+// its block table is checked and the pool recovered from it (pool_file_recover).
+//
+// A shared pool (mem_init_shared) is mapped by several processes at once. Its lock is a
+// process-shared robust mutex in the header, and the header also holds the pool's
+// state: pool_lock loads it into the process's Pool and pool_unlock stores it back, so
+// the block operations run unchanged on whichever process holds the lock.
+
+#define POOL_FILE_MAGIC 0x31304C4F4F504D4DULL  // "MMPOOL01"
+
+// Descriptors a pool file reserves: one per POOL_FILE_TABLE_GRANULE bytes of pool, about
+// 4% of the pool size. The table sits between the header and the pool memory, where it
+// cannot grow, so this is also the most blocks the pool can be cut into: a split that
+// needs another descriptor fails the allocation. ftruncate leaves the file sparse, so
+// table pages never used take no space.
+#define POOL_FILE_TABLE_GRANULE 1024
+
+// How long mem_init_shared waits for the process creating a shared pool to set it up
+#define SHARED_ATTACH_TRIES 1000
+#define SHARED_ATTACH_WAIT_US 1000
+
+typedef struct PoolFile {
+    uint64_t magic;             // POOL_FILE_MAGIC, stored last when the file is set up
+    uint64_t file_size;         // Size of the whole file
+    uint64_t table_offset;      // Offset of the block table arrays in the file
+    uint64_t pool_offset;       // Offset of the pool memory in the file
+    uint64_t pool_size;         // Size of the pool memory
+    uint64_t mapped_at;         // Persistent pools: where the pool memory was mapped last
+    uint32_t table_capacity;    // Descriptors the table holds
+    uint32_t shared;            // 1 for a shared pool
+    uint32_t open;              // Persistent pools: 1 from mem_init_file until mem_deinit, so
+                                // it is still set after the owner died
+    uint32_t attached;          // Shared pools: processes that have the pool mapped
+    uint64_t roots[MEM_ROOTS];  // Root objects as offsets into the pool plus one; 0 for NULL
+
+    // Pool state: as of the last pool_unlock for shared pools; as of the last mem_deinit
+    // for persistent pools, except table_used and head, which pool_unlock keeps current
+    uint32_t table_used;        // BlockTable.used
+    uint32_t table_spare;       // BlockTable.spare
+    uint32_t head;              // Pool.head
+    uint32_t rover;             // Pool.rover
+    uint32_t tree;              // Pool.tree
+    uint32_t policy;            // Pool.policy
+    uint64_t free_classes;      // Pool.free_classes
+    uint64_t largest_free;      // Pool.largest_free
+    uint32_t free_class_count[64]; // Pool.free_class_count
+
+    pthread_mutex_t lock;       // Shared pools: the pool lock, process-shared and robust
+} PoolFile;
+
+static pthread_once_t fork_once = PTHREAD_ONCE_INIT;
+static void cache_fork_child(void);  // Defined with the magazine caches
+
+static void fork_setup(void) {
+    pthread_atfork(NULL, NULL, cache_fork_child);
+}
+
+static inline size_t page_round(size_t bytes) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    return (bytes + page - 1) & ~(page - 1);
+}
+
+// Copies the pool's state from its file header (caller holds the pool lock).
+static void pool_state_load(Pool* pool) {
+    const PoolFile* file = pool->file;
+    pool->blocks.used = file->table_used;
+    pool->blocks.spare = file->table_spare;
+    pool->head = file->head;
+    pool->rover = file->rover;
+    pool->tree = file->tree;
+    pool->policy = (MemPolicy)file->policy;
+    pool->free_classes = file->free_classes;
+    pool->largest_free = file->largest_free;
+    memcpy(pool->free_class_count, file->free_class_count, sizeof(pool->free_class_count));
+}
+
+// Copies the pool's state into its file header (caller holds the pool lock).
+static void pool_state_store(Pool* pool) {
+    PoolFile* file = pool->file;
+    file->table_used = pool->blocks.used;
+    file->table_spare = pool->blocks.spare;
+    file->head = pool->head;
+    file->rover = pool->rover;
+    file->tree = pool->tree;
+    file->policy = (uint32_t)pool->policy;
+    file->free_classes = pool->free_classes;
+    file->largest_free = pool->largest_free;
+    memcpy(file->free_class_count, pool->free_class_count, sizeof(file->free_class_count));
+}
+
+// Takes a pool's lock. For a shared pool this is the mutex in the file, after which the
+// pool's state is loaded from the file. If the process that held it died, the pool is
+// used as it left it, with a warning: an operation it was in the middle of may have
+// left the block list inconsistent.
+static void pool_lock(Pool* pool) {
+    if (!pool->shared) {
+        pthread_mutex_lock(&pool->lock);
+        return;
+    }
+    if (pthread_mutex_lock(&pool->file->lock) == EOWNERDEAD) {
+        fprintf(stderr, "Warning: A process died while holding the shared pool lock.\n");
+        pthread_mutex_consistent(&pool->file->lock);
+    }
+    pool_state_load(pool);
+}
+
+// Releases a pool's lock; a shared pool's state is stored back to the file first. A
+// persistent pool stores only what pool_file_recover cannot rebuild from the table.
+static void pool_unlock(Pool* pool) {
+    if (!pool->shared) {
+        if (pool->file) {
+            pool->file->table_used = pool->blocks.used;
+            pool->file->head = pool->head;
+        }
+        pthread_mutex_unlock(&pool->lock);
+        return;
+    }
+    pool_state_store(pool);
+    pthread_mutex_unlock(&pool->file->lock);
+}
+
+// Checks that a header read from a file of file_size bytes describes a usable pool file
+// of the expected kind.
+static bool pool_file_valid(const PoolFile* file, size_t file_size, bool shared) {
+    return file->magic == POOL_FILE_MAGIC && file->file_size == file_size && file->shared == shared &&
+           file->table_offset >= sizeof(PoolFile) && file->table_capacity > 0 &&
+           file->table_offset + table_bytes(file->table_capacity) <= file->pool_offset &&
+           file->pool_offset + file->pool_size == file_size &&
+           file->table_used <= file->table_capacity && file->head < file->table_used;
+}
+
+// Reads the header of an existing pool file; a shared pool that another process is
+// still creating is waited for.
+// Returns:
+// - true on success, false with errno set (EINVAL if the file is not a pool file).
+static bool pool_file_read(int fd, PoolFile* header, bool shared) {
+    for (int tries = 0;; tries++) {
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            return false;
+        }
+        if ((size_t)st.st_size >= sizeof(PoolFile) && pread(fd, header, sizeof(PoolFile), 0) == (ssize_t)sizeof(PoolFile) &&
+            pool_file_valid(header, (size_t)st.st_size, shared)) {
+            return true;
+        }
+        if (!shared || tries == SHARED_ATTACH_TRIES) {
+            errno = EINVAL;
+            return false;
+        }
+        usleep(SHARED_ATTACH_WAIT_US);
+    }
+}
+
+// Checks the block list of a persistent pool whose owner died and rebuilds what the
+// header may have missed: the spare descriptors, and the free block index. The list
+// must cover the pool exactly, in order; an operation the owner was in the middle of
+// can only be undone if it left the list in that shape. Uses the handle array as the
+// mark of the descriptors in the list; handles do not survive a restart anyway.
+// Returns:
+// - The number of blocks in the list, or 0 if it is inconsistent.
+static size_t pool_file_recover(Pool* pool) {
+    BlockTable* t = &pool->blocks;
+    memset(t->handle, 0, t->used * sizeof(uint32_t));
+    size_t blocks = 0;
+    size_t offset = 0;
+    for (BlockId id = pool->head; id != BLOCK_NIL; id = t->next[id]) {
+        if (id >= t->used || t->handle[id] != 0 || t->offset[id] != offset || t->size[id] == 0 ||
+            t->size[id] > pool->size - offset) {
+            memset(t->handle, 0, t->used * sizeof(uint32_t));
+            return 0;
+        }
+        t->handle[id] = 1;
+        offset += t->size[id];
+        blocks++;
+    }
+    if (offset != pool->size) {
+        memset(t->handle, 0, t->used * sizeof(uint32_t));
+        return 0;
+    }
+
+    // Every descriptor not in the list is spare
+    t->spare = BLOCK_NIL;
+    for (BlockId id = t->used; id-- > 0;) {
+        if (t->handle[id] == 0) {
+            t->next[id] = t->spare;
+            t->spare = id;
+        }
+        t->handle[id] = 0;
+    }
+    return blocks;
+}
+
+// Maps a pool file as pools[0], laying it out for a pool of size bytes if create is set.
+// Takes ownership of fd, which a persistent pool keeps open for its flock.
+// Returns:
+// - 0 if the pool was created, 1 if an existing one was mapped, 2 if a persistent pool
+//   was recovered after its owner died, or -1 with errno set.
+static int pool_file_open(int fd, size_t size, bool create, bool shared) {
+    PoolFile header = { 0 };
+    void* hint = NULL;
+    if (create) {
+        size_t capacity = size / POOL_FILE_TABLE_GRANULE + BLOCK_TABLE_MIN;
+        header.table_capacity = capacity > BLOCK_NIL / 2 ? BLOCK_NIL / 2 : (uint32_t)capacity;
+        header.table_offset = page_round(sizeof(PoolFile));
+        header.pool_offset = page_round(header.table_offset + table_bytes(header.table_capacity));
+        header.pool_size = size;
+        header.file_size = header.pool_offset + size;
+        header.shared = shared;
+        if (size == 0) {
+            errno = EINVAL;
+        }
+        if (size == 0 || ftruncate(fd, (off_t)header.file_size) != 0) {
+            int error = errno;
+            close(fd);
+            errno = error;
+            return -1;
+        }
+    } else {
+        if (!pool_file_read(fd, &header, shared)) {
+            int error = errno;
+            close(fd);
+            errno = error;
+            return -1;
+        }
+        if (!shared && header.mapped_at > header.pool_offset) {
+            hint = (void*)(uintptr_t)(header.mapped_at - header.pool_offset);
+        }
+    }
+
+    char* mapping = (char*)mmap(hint, header.file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    int error = errno;
+    if (shared || mapping == MAP_FAILED) {
+        close(fd);  // The mapping keeps the file open
+    }
+    if (mapping == MAP_FAILED) {
+        errno = error;
+        return -1;
+    }
+
+    PoolFile* file = (PoolFile*)mapping;
+    Pool* pool = &pools[0];
+    table_place(&pool->blocks, mapping + header.table_offset, header.table_capacity);
+    pool->blocks.fixed = true;
+    if (create) {
+        memcpy(file, &header, offsetof(PoolFile, roots));
+        if (shared) {
+            pthread_mutexattr_t attr;
+            pthread_mutexattr_init(&attr);
+            pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+            pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+            pthread_mutex_init(&file->lock, &attr);
+            pthread_mutexattr_destroy(&attr);
+        }
+        pool_format(pool, mapping + header.pool_offset, size, true, 0, 0, false);
+        pool->file = file;
+        pool_state_store(pool);
+        file->attached = 1;
+        __atomic_store_n(&file->magic, POOL_FILE_MAGIC, __ATOMIC_RELEASE);
+    } else {
+        pool->base = mapping + file->pool_offset;
+        pool->size = file->pool_size;
+        pool->granule = 0;
+        pool->node = 0;
+        pool->memory_node = 0;
+        pool->mapped = false;
+        pool->file = file;
+        if (shared) {
+            pool->shared = true;
+            pool_lock(pool);
+            file->attached++;
+            pool_unlock(pool);
+        } else {
+            pool_state_load(pool);
+            if (file->open && pool_file_recover(pool) == 0) {
+                fprintf(stderr, "Warning: The block table of a pool file left open by a dead process is inconsistent.\n");
+                pool->file = NULL;
+                munmap(mapping, header.file_size);
+                close(fd);
+                errno = EINVAL;
+                return -1;
+            }
+            // Handles belong to the process that allocated them
+            memset(pool->blocks.handle, 0, pool->blocks.used * sizeof(uint32_t));
+            pool_set_policy(pool, (MemPolicy)atomic_load(&default_policy));
+        }
+    }
+    pool->shared = shared;
+    pool->file_fd = shared ? -1 : fd;
+    bool recovered = !create && !shared && file->open;
+    if (!shared) {
+        file->mapped_at = (uint64_t)(uintptr_t)pool->base;
+        file->open = 1;
+    }
+    atomic_store(&pool_count, 1);
+    atomic_fetch_add(&mem_pool_generation, 1);
+    return create ? 0 : recovered ? 2 : 1;
+}
+
+// Opens a pool whose memory and bookkeeping live in a file, for a fast warm restart
+// A new (missing or empty) file is laid out for a pool of size bytes. An existing file
+// is mapped again with its blocks and root objects as mem_deinit left them; handles do
+// not survive, their blocks become plain blocks. The pool memory is mapped at its
+// previous address when that is free, so pointers stored inside it stay valid; check
+// mem_pool_base(), or store offsets from it, if that matters. Storing the file on tmpfs
+// (/dev/shm) keeps it in memory across process restarts. The block table in the file has
+// a fixed size: the pool holds at most size / 1024 + 64 blocks, and an allocation that
+// would need one more fails.
+// Parameters:
+// - path: the pool file.
+// - size: the size of the memory pool for a new file; ignored for an existing one.
+// Returns:
+// - 0 if a new pool was created, 1 if an existing one was restored, 2 if it was
+//   restored from a file whose owner died without mem_deinit (the blocks are as of the
+//   owner's last completed operation; its data may be half written), or -1 with errno
+//   set: EINVAL if the file is not a pool file (or size is 0 for a new one, or the file
+//   of a dead owner is inconsistent), EBUSY if it is open in a live process.
+int mem_init_file(const char* path, size_t size) {
+    int fd = open(path, O_RDWR | O_CREAT, 0600);
+    if (fd < 0) {
+        return -1;
+    }
+    // The lock is the file's owner, until mem_deinit or the owner's death
+    if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        int error = errno == EWOULDBLOCK ? EBUSY : errno;
+        close(fd);
+        errno = error;
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+    return pool_file_open(fd, size, st.st_size == 0, false);
+}
+
+// Opens a pool shared by several processes
+// The first process to open a name creates the pool; later ones, and children forked
+// after mem_init_shared, allocate from and free into the same pool, so a block can be
+// handed to another process without copying: pass mem_to_offset(ptr) (or set a root)
+// and turn it back with mem_from_offset, as the pool may be mapped at a different
+// address in each process. Any process may free any block. Handles and compaction are
+// not available in shared pools. A child forked later starts with empty caches, since
+// the blocks in them are the parent's. The object stays until shm_unlink(name). As with
+// mem_init_file, the pool holds at most size / 1024 + 64 blocks.
+// Parameters:
+// - name: the POSIX shared memory object, "/name".
+// - size: the size of the memory pool if it is created here; ignored otherwise.
+// Returns:
+// - 0 if the pool was created, 1 if an existing one was opened, or -1 with errno set
+//   (EINVAL if the object is not a shared pool or size is 0 for a new one).
+int mem_init_shared(const char* name, size_t size) {
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    bool create = fd >= 0;
+    if (!create && errno == EEXIST) {
+        fd = shm_open(name, O_RDWR, 0600);
+    }
+    if (fd < 0) {
+        return -1;
+    }
+    pthread_once(&fork_once, fork_setup);
+    return pool_file_open(fd, size, create, true);
+}
+
+// Detaches from a pool file and unmaps it. A persistent pool's state is saved in the
+// header and flushed to storage first.
+static void pool_file_close(Pool* pool) {
+    PoolFile* file = pool->file;
+    size_t file_size = file->file_size;
+    if (pool->shared) {
+        pool_lock(pool);
+        file->attached--;
+        pool_unlock(pool);
+    } else {
+        pool_state_store(pool);
+        file->open = 0;
+        msync(file, file_size, MS_SYNC);
+    }
+    munmap(file, file_size);
+    if (pool->file_fd >= 0) {
+        close(pool->file_fd);  // Releases the flock
+    }
+    pool->file = NULL;
+    pool->file_fd = -1;
+    pool->shared = false;
+}
+
+// Stores a root object of the pool file: the entry point to data that should be found
+// again after a restart, or by another process sharing the pool
+// Parameters:
+// - index: the root, below MEM_ROOTS.
+// - ptr: a pointer into the memory of the pool file, or NULL to clear the root.
+// Errors:
+// - Prints a warning and does nothing without a pool file, for an index out of range or
+//   for a pointer outside the pool file.
+void mem_set_root(unsigned index, void* ptr) {
+    Pool* pool = &pools[0];
+    if (atomic_load(&pool_count) == 0 || !pool->file || index >= MEM_ROOTS ||
+        (ptr && pool_of(ptr) != pool)) {
+        fprintf(stderr, "Warning: Cannot set root %u to %p; roots need a pool from mem_init_file or mem_init_shared.\n", index, ptr);
+        return;
+    }
+    pool_lock(pool);
+    pool->file->roots[index] = ptr ? (uint64_t)((char*)ptr - pool->base) + 1 : 0;
+    pool_unlock(pool);
+}
+
+// Returns a root object of the pool file, or NULL if it is not set, index is out of
+// range or the pool does not come from mem_init_file or mem_init_shared.
+void* mem_root(unsigned index) {
+    Pool* pool = &pools[0];
+    if (atomic_load(&pool_count) == 0 || !pool->file || index >= MEM_ROOTS) {
+        return NULL;
+    }
+    pool_lock(pool);
+    uint64_t root = pool->file->roots[index];
+    pool_unlock(pool);
+    return root ? pool->base + (root - 1) : NULL;
+}
+
+// Returns the offset of ptr from the start of the first pool, which stays the same in
+// every process mapping a shared or persistent pool, or SIZE_MAX if ptr is not in it.
+size_t mem_to_offset(const void* ptr) {
+    Pool* pool = &pools[0];
+    if (atomic_load(&pool_count) == 0 || pool_of(ptr) != pool) {
+        return SIZE_MAX;
+    }
+    return (size_t)((const char*)ptr - pool->base);
+}
+
+// Returns the address of an offset from mem_to_offset in this process, or NULL if it
+// lies outside the first pool.
+void* mem_from_offset(size_t offset) {
+    Pool* pool = &pools[0];
+    if (atomic_load(&pool_count) == 0 || offset >= pool->size) {
+        return NULL;
+    }
+    return pool->base + offset;
+}
+
+// Marks a free block allocated, splitting the part beyond size off as a new free block
+// (caller holds pool->lock).
+// Returns:
+// - The block's memory, or NULL if the descriptor for the remainder cannot be allocated.
+static void* block_take(Pool* pool, BlockId current, size_t size) {
+    BlockTable* t = &pool->blocks;
+    // If the block is larger than needed, split it
+    if (t->size[current] > size) {
+        // Create a new descriptor for the remaining free memory
+        BlockId new_block = block_new(pool);
+        if (new_block == BLOCK_NIL) {
+            perror("New block metadata allocation failed");
+            return NULL;
+        }
+        free_index_remove(pool, current);
+
+        t->size[new_block] = t->size[current] - size;
+        t->is_free[new_block] = 1;
+        t->offset[new_block] = t->offset[current] + size;
+        t->next[new_block] = t->next[current];
+        t->clean[new_block] = t->clean[current] > size ? t->clean[current] - size : 0;
+        free_index_insert(pool, new_block);
+
+        t->size[current] = size;
+        t->next[current] = new_block;
+    } else {
+        free_index_remove(pool, current);
+    }
+    t->is_free[current] = 0;
+    t->handle[current] = 0;
+    pool->live_blocks++;
+
+    // Return the pointer to the allocated memory
+    return block_ptr(pool, current);
+}
+
+// Allocates a block of memory of the specified size (caller holds pool->lock)
+static void* block_alloc(Pool* pool, size_t size) {
+    if (pool->granule) {
+        return bitmap_alloc(pool, size);
+    }
+    // Find a free block that is large enough according to the placement policy
+    BlockId current = block_find(pool, size);
+    if (current == BLOCK_NIL) {
+        // If no suitable block is found, return NULL (allocation failure)
+        return NULL;
+    }
+
+    return block_take(pool, current, size);
+}
+
+// Allocates a block like block_alloc and reports how many of its leading bytes may be
+// non-zero; the rest lies in the zero tail of the free block it came from (caller holds
+// pool->lock).
+static void* block_alloc_dirty(Pool* pool, size_t size, size_t* dirty) {
+    if (pool->granule) {
+        *dirty = size;  // Bitmap pools do not track zeroed memory
+        return bitmap_alloc(pool, size);
+    }
+    BlockId current = block_find(pool, size);
+    if (current == BLOCK_NIL) {
+        return NULL;
+    }
+    size_t clean = pool->blocks.clean[current];
+    *dirty = clean < size ? clean : size;
+    return block_take(pool, current, size);
+}
+
+// Allocates a block whose address is a multiple of alignment, a power of two (caller
+// holds pool->lock). The unaligned start of the free block it is cut from stays free as
+// a block of its own. Aligned requests always take the first block that fits.
+static void* block_alloc_aligned(Pool* pool, size_t alignment, size_t size) {
+    if (pool->granule) {
+        return bitmap_alloc_aligned(pool, alignment, size);
+    }
+    if (!pool_may_fit(pool, size)) {
+        return NULL;
+    }
+    BlockTable* t = &pool->blocks;
+    for (BlockId current = pool->head; current != BLOCK_NIL; current = t->next[current]) {
+        if (!t->is_free[current]) {
+            continue;
+        }
+        uintptr_t start = (uintptr_t)block_ptr(pool, current);
+        size_t pad = (size_t)(((start + alignment - 1) & ~(uintptr_t)(alignment - 1)) - start);
+        if (t->size[current] < pad || t->size[current] - pad < size) {
+            continue;
+        }
+
+        if (pad > 0) {
+            BlockId aligned = block_new(pool);
+            if (aligned == BLOCK_NIL) {
+                perror("New block metadata allocation failed");
+                return NULL;
+            }
+            free_index_remove(pool, current);
+            t->size[aligned] = t->size[current] - pad;
+            t->is_free[aligned] = 1;
+            t->offset[aligned] = t->offset[current] + pad;
+            t->next[aligned] = t->next[current];
+            t->clean[aligned] = t->clean[current] > pad ? t->clean[current] - pad : 0;
+
+            t->size[current] = pad;
+            t->clean[current] = t->clean[current] < pad ? t->clean[current] : pad;
+            t->next[current] = aligned;
+            free_index_insert(pool, current);
+            free_index_insert(pool, aligned);
+            current = aligned;
+        }
+        return block_take(pool, current, size);
+    }
+    return NULL;
+}
+
+// Merges the free block after current into it (caller holds pool->lock). The zero tail
+// of the merged block is the next block's, extended into current if next is all zero.
+// current must not be in the free block tree while its size changes.
+static void block_merge_next(Pool* pool, BlockId current) {
+    BlockTable* t = &pool->blocks;
+    BlockId next_block = t->next[current];
+    free_index_remove(pool, next_block);
+    if (pool->rover == next_block) {
+        pool->rover = current;
+    }
+    t->clean[current] = t->clean[next_block] == 0 ? t->clean[current] : t->size[current] + t->clean[next_block];
+    t->size[current] += t->size[next_block];
+    t->next[current] = t->next[next_block];
+    block_delete(pool, next_block);
+}
+
+// Returns true if the block after id exists and is free.
+static inline bool next_is_free(const Pool* pool, BlockId id) {
+    BlockId next_block = pool->blocks.next[id];
+    return next_block != BLOCK_NIL && pool->blocks.is_free[next_block];
+}
+
+// Hands the dirty pages of a large free block in a mapped pool back to the kernel, so they
+// stop counting towards the resident set and read back as zero (caller holds pool->lock).
+static void block_purge(Pool* pool, BlockId id) {
+    BlockTable* t = &pool->blocks;
+    if (!pool->mapped || t->clean[id] < PURGE_MIN_BYTES) {
+        return;
+    }
+    uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+    uintptr_t ptr = (uintptr_t)block_ptr(pool, id);
+    uintptr_t start = (ptr + page - 1) & ~(page - 1);
+    uintptr_t dirty_end = ptr + t->clean[id];
+    uintptr_t end = dirty_end & ~(page - 1);
+    if (end <= start || madvise((void*)start, end - start, MADV_DONTNEED) != 0) {
+        return;
+    }
+    // Zero the partial page up to the zero tail, which then starts at the first purged page
+    memset((void*)end, 0, dirty_end - end);
+    t->clean[id] = start - ptr;
+}
+
+// Frees a previously allocated block of memory (caller holds pool->lock)
+static void block_free(Pool* pool, void* ptr) {
+    if (pool->granule) {
+        bitmap_free(pool, ptr);
+        return;
+    }
+    if (!ptr) {
+        fprintf(stderr, "Warning: Attempted to free a NULL pointer.\n");
+        return;
+    }
+
+    // Find the block descriptor corresponding to the pointer
+    BlockId current = block_at(pool, ptr);
+    if (current == BLOCK_NIL) {
+        fprintf(stderr, "Warning: Pointer %p not found in the memory pool.\n", ptr);
+        return;
+    }
+    BlockTable* t = &pool->blocks;
+    if (t->is_free[current]) {
+        fprintf(stderr, "Warning: Attempted to free an already freed block at %p.\n", ptr);
+        return;
+    }
+
+    t->is_free[current] = 1;
+    t->clean[current] = t->size[current];
+    pool->live_blocks--;
+
+    // Coalesce adjacent free blocks to prevent fragmentation
+    while (next_is_free(pool, current)) {
+        block_merge_next(pool, current);
+    }
+    block_purge(pool, current);
+    free_index_insert(pool, current);
+
+    // Free blocks only merge with the ones after them, so an emptied short-lived
+    // sub-pool is merged back into one block here, ready for the next burst
+    if (pool->lifetime == MEM_SHORT_LIVED && pool->live_blocks == 0 && pool->head != current) {
+        BlockId head = pool->head;
+        free_index_remove(pool, head);
+        while (next_is_free(pool, head)) {
+            block_merge_next(pool, head);
+        }
+        block_purge(pool, head);
+        free_index_insert(pool, head);
+    }
+}
+
+// Carves count adjacent blocks of size bytes out of a free block that holds them all
+// (caller holds pool->lock).
+// Returns:
+// - true on success, false if no single free block is large enough or metadata allocation fails.
+static bool block_alloc_run(Pool* pool, size_t size, size_t count, void** out) {
+    if (pool->granule) {
+        return bitmap_alloc_run(pool, size, count, out);
+    }
+    size_t total = size * count;
+    BlockId current = block_find(pool, total);
+    if (current == BLOCK_NIL) {
+        return false;
+    }
+
+    // Descriptors for every piece after the first, plus one for any free remainder.
+    BlockTable* t = &pool->blocks;
+    size_t extra = count - 1 + (t->size[current] > total ? 1 : 0);
+    BlockId first_new = BLOCK_NIL;
+    BlockId last_new = BLOCK_NIL;
+    for (size_t i = 0; i < extra; i++) {
+        BlockId block = block_new(pool);
+        if (block == BLOCK_NIL) {
+            perror("New block metadata allocation failed");
+            while (first_new != BLOCK_NIL) {
+                BlockId next = t->next[first_new];
+                block_delete(pool, first_new);
+                first_new = next;
+            }
+            return false;
+        }
+        t->next[block] = BLOCK_NIL;
+        if (last_new != BLOCK_NIL) {
+            t->next[last_new] = block;
+        } else {
+            first_new = block;
+        }
+        last_new = block;
+    }
+    free_index_remove(pool, current);
+
+    size_t offset = t->offset[current];
+    size_t remainder = t->size[current] - total;
+    size_t clean = t->clean[current];
+    BlockId tail = t->next[current];
+    BlockId block = current;
+    for (size_t i = 0; i < count; i++) {
+        if (i > 0) {
+            block = first_new;
+            first_new = t->next[first_new];
+        }
+        t->offset[block] = offset + i * size;
+        t->size[block] = size;
+        t->is_free[block] = 0;
+        t->handle[block] = 0;
+        out[i] = block_ptr(pool, block);
+        pool->live_blocks++;
+        if (i + 1 < count) {
+            t->next[block] = first_new;
+        }
+    }
+    if (remainder > 0) {
+        BlockId rest = first_new;
+        t->offset[rest] = offset + total;
+        t->size[rest] = remainder;
+        t->is_free[rest] = 1;
+        t->clean[rest] = clean > total ? clean - total : 0;
+        free_index_insert(pool, rest);
+        t->next[block] = rest;
+        block = rest;
+    }
+    t->next[block] = tail;
+    return true;
+}
+
+static int compare_pointers(const void* a, const void* b) {
+    uintptr_t pa = (uintptr_t)*(void* const*)a;
+    uintptr_t pb = (uintptr_t)*(void* const*)b;
+    return (pa > pb) - (pa < pb);
+}
+
+// Frees several blocks with one walk of the block list (caller holds pool->lock).
+// The pointers must be sorted by address so they can be matched in order; each freed
+// block is coalesced with the free run in front of it and the free blocks after it as
+// the walk passes, so only the neighbourhood of the freed blocks is touched.
+static void block_free_many(Pool* pool, void** ptrs, size_t count) {
+    if (pool->granule) {
+        for (size_t i = 0; i < count; i++) {
+            bitmap_free(pool, ptrs[i]);
+        }
+        return;
+    }
+    size_t i = 0;
+    while (i < count && ptrs[i] == NULL) {
+        fprintf(stderr, "Warning: Attempted to free a NULL pointer.\n");
+        i++;
+    }
+
+    BlockTable* t = &pool->blocks;
+    void* matched = NULL;  // Last pointer that matched a block
+    BlockId run = BLOCK_NIL;  // First block of the free run ending before current
+    BlockId current = pool->head;
+    while (current != BLOCK_NIL && i < count) {
+        if (ptrs[i] == matched) {
+            // The walk has moved past the block; a repeated pointer frees it twice
+            fprintf(stderr, "Warning: Attempted to free an already freed block at %p.\n", ptrs[i]);
+            i++;
+            continue;
+        }
+        char* ptr = block_ptr(pool, current);
+        if (ptr < (char*)ptrs[i]) {
+            run = t->is_free[current] ? (run != BLOCK_NIL ? run : current) : BLOCK_NIL;
+            current = t->next[current];
+            continue;
+        }
+        if (ptr == ptrs[i]) {
+            matched = ptrs[i];
+            if (t->is_free[current]) {
+                fprintf(stderr, "Warning: Attempted to free an already freed block at %p.\n", ptrs[i]);
+            } else {
+                t->is_free[current] = 1;
+                t->clean[current] = t->size[current];
+                pool->live_blocks--;
+
+                // Coalesce with the free run in front and the free blocks that follow
+                BlockId start = current;
+                if (run != BLOCK_NIL) {
+                    start = run;
+                    free_index_remove(pool, start);
+                }
+                while (next_is_free(pool, start)) {
+                    block_merge_next(pool, start);
+                }
+                block_purge(pool, start);
+                free_index_insert(pool, start);
+                current = start;
+            }
+            run = t->is_free[current] ? (run != BLOCK_NIL ? run : current) : BLOCK_NIL;
+            current = t->next[current];
+        } else {
+            fprintf(stderr, "Warning: Pointer %p not found in the memory pool.\n", ptrs[i]);
+        }
+        i++;
+    }
+    for (; i < count; i++) {
+        if (ptrs[i] == matched) {
+            fprintf(stderr, "Warning: Attempted to free an already freed block at %p.\n", ptrs[i]);
+        } else {
+            fprintf(stderr, "Warning: Pointer %p not found in the memory pool.\n", ptrs[i]);
+        }
+    }
+
+    // As in block_free, an emptied short-lived sub-pool is merged back into one block
+    BlockId head = pool->head;
+    if (pool->lifetime == MEM_SHORT_LIVED && pool->live_blocks == 0 && head != BLOCK_NIL &&
+        next_is_free(pool, head)) {
+        free_index_remove(pool, head);
+        while (next_is_free(pool, head)) {
+            block_merge_next(pool, head);
+        }
+        block_purge(pool, head);
+        free_index_insert(pool, head);
+    }
+}
+
+// Sorts the pointers by address and frees them with one block_free_many per pool.
+// Pointers outside every pool are handed to the first pool, which reports them.
+static void pools_free_many(void** ptrs, size_t count) {
+    qsort(ptrs, count, sizeof(void*), compare_pointers);
+
+    size_t i = 0;
+    while (i < count) {
+        Pool* pool = pool_of(ptrs[i]);
+        size_t end = i + 1;
+        while (end < count && pool_of(ptrs[end]) == pool) {
+            end++;
+        }
+        if (!pool) {
+            pool = &pools[0];
+        }
+        pool_lock(pool);
+        block_free_many(pool, ptrs + i, end - i);
+        pool_unlock(pool);
+        i = end;
+    }
+}
+
+// Resizes a previously allocated block of memory (caller holds pool->lock)
+static void* block_resize(Pool* pool, void* ptr, size_t size) {
+    if (pool->granule) {
+        return bitmap_resize(pool, ptr, size);
+    }
+    if (!ptr) return block_alloc(pool, size); // If ptr is NULL, just allocate new memory
+
+    BlockId block = block_at(pool, ptr);
+    if (block != BLOCK_NIL) {
+        size_t old_size = pool->blocks.size[block];
+        if (old_size >= size) {
+            // If the current block is already large enough, return the same pointer
+            return ptr;
+        } else {
+            // Allocate a new block and copy the old data to it
+            void* new_ptr = block_alloc(pool, size);
+            if (new_ptr) {
+                memcpy(new_ptr, ptr, old_size);
+                block_free(pool, ptr);
+            }
+            return new_ptr;
+        }
+    }
+
+    fprintf(stderr, "Warning: Pointer %p not found for resizing.\n", ptr);
+    return NULL;  // If the block was not found
+}
+
+// ********* Memory pressure *********
+
+// An allocation that finds no room in any pool asks the pressure handler to make some
+// (flush caches, reclaim retired blocks, compact handles, or release memory held by the
+// application) and is retried as long as the handler reports progress, at most
+// PRESSURE_RETRIES times. Magazine refills call the handler only once the refill has
+// failed and no magazine is being filled, so the handler may flush the caches.
+
+#define PRESSURE_RETRIES 3
+
+// The handler and its argument change together under pressure_lock. Callers copy both
+// out and call the handler after releasing it, so a handler may replace itself.
+static MemPressureHandler pressure_handler = NULL;
+static void* pressure_arg = NULL;
+static pthread_mutex_t pressure_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Asks the pressure handler to make room for size bytes after attempt failed attempts.
+// Returns:
+// - true if the allocation should be retried.
+static bool pressure_relieved(size_t size, int attempt) {
+    if (attempt >= PRESSURE_RETRIES) {
+        return false;
+    }
+    pthread_mutex_lock(&pressure_lock);
+    MemPressureHandler handler = pressure_handler;
+    void* arg = pressure_arg;
+    pthread_mutex_unlock(&pressure_lock);
+    return handler && handler(size, arg);
+}
+
+// Returns true if the pool serves requests without a lifetime hint; short-lived
+// sub-pools serve only mem_alloc_hint with MEM_SHORT_LIVED.
+static inline bool pool_general(const Pool* pool) {
+    return pool->lifetime != MEM_SHORT_LIVED;
+}
+
+// Allocates size bytes from the pools, the calling thread's node first. Short-lived
+// requests try the short-lived sub-pools before the general pools.
+static void* pools_alloc(size_t size, MemLifetime lifetime) {
+    int local = pool_local();
+    int count = atomic_load(&pool_count);
+    void* ptr = NULL;
+    for (int pass = lifetime == MEM_SHORT_LIVED ? 0 : 1; pass < 2 && ptr == NULL; pass++) {
+        for (int i = 0; i < count && ptr == NULL; i++) {
+            Pool* pool = &pools[(local + i) % count];
+            if (pool_general(pool) != (pass == 1)) {
+                continue;
+            }
+            pool_lock(pool);
+            ptr = block_alloc(pool, size);
+            pool_unlock(pool);
+        }
+    }
+    return ptr;
+}
+
+// Allocates count blocks of size bytes from the pools, carving them from one free block
+// where possible. Returns the number allocated.
+static size_t pools_alloc_many(size_t size, size_t count, void** out) {
+    int local = pool_local();
+    int pools_in_use = atomic_load(&pool_count);
+    bool run = size > 0 && size <= SIZE_MAX / count;
+    size_t allocated = 0;
+    for (int i = 0; i < pools_in_use && allocated < count; i++) {
+        Pool* pool = &pools[(local + i) % pools_in_use];
+        if (!pool_general(pool)) {
+            continue;
+        }
+        pool_lock(pool);
+        if (run && block_alloc_run(pool, size, count - allocated, out + allocated)) {
+            allocated = count;
+        } else {
+            while (allocated < count && (out[allocated] = block_alloc(pool, size)) != NULL) {
+                allocated++;
+            }
+        }
+        pool_unlock(pool);
+    }
+    return allocated;
+}
+
+// Returns true if some pool has a free run that can hold size bytes.
+static bool pools_may_fit(size_t size) {
+    int count = atomic_load(&pool_count);
+    bool fits = false;
+    for (int i = 0; i < count && !fits; i++) {
+        Pool* pool = &pools[i];
+        pool_lock(pool);
+        if (pool->granule) {
+            fits = size <= pool->size && bitmap_find(pool, bitmap_granules(pool, size), 1, 0) != SIZE_MAX;
+        } else {
+            pool_refresh_largest(pool);
+            fits = pool_may_fit(pool, size);
+        }
+        pool_unlock(pool);
+    }
+    return fits;
+}
+
+// Installs a handler called when an allocation cannot be served
+// The handler gets the requested size and arg, and returns true if it freed memory and
+// the allocation should be retried. It runs on the allocating thread without any
+// allocator lock held, so it may call any function of the allocator; an allocation of
+// its own that fails calls it again, recursively.
+// Parameters:
+// - handler: the handler, or NULL to remove it; it stays installed across mem_deinit.
+// - arg: passed to every call of the handler.
+// Thread safety:
+// - Safe to call concurrently with the allocation functions: a handler is always called
+//   with the arg installed along with it. A call already under way may still run the
+//   handler that was replaced.
+void mem_set_pressure_handler(MemPressureHandler handler, void* arg) {
+    pthread_mutex_lock(&pressure_lock);
+    pressure_handler = handler;
+    pressure_arg = arg;
+    pthread_mutex_unlock(&pressure_lock);
+}
+
+// A ready-made pressure handler
+// Returns the calling thread's cached blocks to the pools, frees retired blocks whose
+// grace period is over, and compacts the pools fully.
+// Parameters:
+// - size: the size of the failed allocation.
+// - arg: unused.
+// Returns:
+// - true if a free run of size bytes exists afterwards.
+bool mem_pressure_trim(size_t size, void* arg) {
+    (void)arg;
+    mem_cache_flush();
+    mem_inline_flush();
+    mem_reclaim();
+    mem_compact(SIZE_MAX);
+    return pools_may_fit(size);
+}
+
+// Allocates a block of memory of the specified size
+// With NUMA pools the calling thread's node is tried first, then the other nodes.
+// Parameters:
+// - size: the size of the memory to allocate.
+// Returns:
+// - A pointer to the allocated memory if successful, or NULL if no suitable block is
+//   found even after the pressure handler ran.
+// Thread safety:
+// - Safe to call concurrently with mem_alloc, mem_free and mem_resize.
+void* mem_alloc(size_t size) {
+    void* ptr;
+    for (int attempt = 0; (ptr = pools_alloc(size, MEM_LONG_LIVED)) == NULL && pressure_relieved(size, attempt); attempt++) {
+    }
+    return ptr;
+}
+
+// Allocates a block of memory of the specified size, placed by its expected lifetime
+// Short-lived requests are served from the sub-pools added with mem_grow_hint(size,
+// MEM_SHORT_LIVED), which no other request allocates from: once their blocks are freed
+// these sub-pools are empty again and coalesce into one free block, instead of being
+// pinned by a long-lived block allocated in between. Short-lived requests fall back to
+// the general pools when no sub-pool has room.
+// Parameters:
+// - size: the size of the memory to allocate.
+// - lifetime: MEM_SHORT_LIVED for blocks freed again soon (per request or per frame
+//   buffers, temporaries), MEM_LONG_LIVED for anything else, as mem_alloc.
+// Returns:
+// - A pointer to the allocated memory, or NULL as for mem_alloc.
+// Thread safety:
+// - Safe to call concurrently with the other allocation functions.
+void* mem_alloc_hint(size_t size, MemLifetime lifetime) {
+    void* ptr;
+    for (int attempt = 0; (ptr = pools_alloc(size, lifetime)) == NULL && pressure_relieved(size, attempt); attempt++) {
+    }
+    return ptr;
+}
+
+// Allocates zeroed memory for an array of count elements of size bytes each
+// Only the part of the block that may have been used before is cleared: memory the pool
+// has never handed out, or that was purged with MADV_DONTNEED, is already zero.
+// Parameters:
+// - count: the number of elements.
+// - size: the size of every element.
+// Returns:
+// - A pointer to the zeroed memory, or NULL if count * size overflows or no suitable
+//   block is found.
+// Thread safety:
+// - Safe to call concurrently with the other allocation functions.
+void* mem_calloc(size_t count, size_t size) {
+    if (size != 0 && count > SIZE_MAX / size) {
+        return NULL;
+    }
+    size_t total = count * size;
+
+    int local = pool_local();
+    void* ptr = NULL;
+    size_t dirty = 0;
+    for (int attempt = 0; ptr == NULL; attempt++) {
+        int pools_in_use = atomic_load(&pool_count);
+        for (int i = 0; i < pools_in_use && ptr == NULL; i++) {
+            Pool* pool = &pools[(local + i) % pools_in_use];
+            if (!pool_general(pool)) {
+                continue;
+            }
+            pool_lock(pool);
+            ptr = block_alloc_dirty(pool, total, &dirty);
+            pool_unlock(pool);
+        }
+        if (ptr == NULL && !pressure_relieved(total, attempt)) {
+            return NULL;
+        }
+    }
+    if (ptr) {
+        memset(ptr, 0, dirty);
+    }
+    return ptr;
+}
+
+// Frees a previously allocated block of memory
+// Parameters:
+// - ptr: the pointer to the memory to be freed.
+// Errors:
+// - Ignores attempts to free NULL pointers.
+// - Prints a warning if the pointer does not correspond to any allocated block.
+// Thread safety:
+// - Safe to call concurrently with mem_alloc, mem_free and mem_resize.
+void mem_free(void* ptr) {
+    Pool* pool = pool_of(ptr);
+    if (!pool) {
+        pool = &pools[0];  // block_free reports the pointer
+    }
+    pool_lock(pool);
+    block_free(pool, ptr);
+    pool_unlock(pool);
+}
+
+// Resizes a previously allocated block of memory
+// A block that has to move stays in the pool (NUMA node) it was allocated from.
+// Parameters:
+// - ptr: the pointer to the memory to resize.
+// - size: the new size for the memory block.
+// Returns:
+// - A pointer to the resized memory block if successful, or NULL if resizing fails.
+// Thread safety:
+// - Safe to call concurrently with mem_alloc, mem_free and mem_resize.
+void* mem_resize(void* ptr, size_t size) {
+    if (!ptr) {
+        return mem_alloc(size);
+    }
+    Pool* pool = pool_of(ptr);
+    if (!pool) {
+        pool = &pools[0];  // block_resize reports the pointer
+    }
+    void* new_ptr;
+    for (int attempt = 0;; attempt++) {
+        pool_lock(pool);
+        new_ptr = block_resize(pool, ptr, size);
+        pool_unlock(pool);
+        if (new_ptr || pool_of(ptr) != pool || !pressure_relieved(size, attempt)) {
+            return new_ptr;
+        }
+    }
+}
+
+// Allocates count blocks of the specified size
+// The blocks are carved from a single free block when one is large enough, which takes
+// one walk of the block list; otherwise they are allocated one by one. With NUMA pools
+// the calling thread's node is used first.
+// Parameters:
+// - size: the size of every block.
+// - count: the number of blocks to allocate.
+// - out: receives the pointers to the allocated blocks.
+// Returns:
+// - The number of blocks allocated; out[0..n-1] are valid. Fewer than count means the
+//   pool ran out even after the pressure handler ran.
+// Thread safety:
+// - Safe to call concurrently with the other allocation functions.
+size_t mem_alloc_many(size_t size, size_t count, void** out) {
+    if (count == 0) {
+        return 0;
+    }
+    size_t allocated = pools_alloc_many(size, count, out);
+    for (int attempt = 0; allocated < count && pressure_relieved(size, attempt); attempt++) {
+        allocated += pools_alloc_many(size, count - allocated, out + allocated);
+    }
+    return allocated;
+}
+
+// Frees several previously allocated blocks
+// Costs one walk of the block list plus sorting the pointers, instead of one walk per block.
+// Parameters:
+// - ptrs: the pointers to free; the array is reordered (sorted by address).
+// - count: the number of pointers.
+// Errors:
+// - Prints a warning for NULL pointers, already freed blocks and unknown pointers.
+// Thread safety:
+// - Safe to call concurrently with the other allocation functions.
+void mem_free_many(void** ptrs, size_t count) {
+    if (count == 0) {
+        return;
+    }
+    pools_free_many(ptrs, count);
+}
+
+// Allocates a block of memory whose address is a multiple of alignment
+// Parameters:
+// - alignment: a power of two.
+// - size: the size of the memory to allocate.
+// Returns:
+// - A pointer to the allocated memory, or NULL if alignment is not a power of two or no
+//   free block can hold an aligned block of size bytes even after the pressure handler ran.
+// Thread safety:
+// - Safe to call concurrently with the other allocation functions.
+void* mem_alloc_aligned(size_t alignment, size_t size) {
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        return NULL;
+    }
+
+    int local = pool_local();
+    void* ptr = NULL;
+    for (int attempt = 0; ptr == NULL; attempt++) {
+        int count = atomic_load(&pool_count);
+        for (int i = 0; i < count && ptr == NULL; i++) {
+            Pool* pool = &pools[(local + i) % count];
+            if (!pool_general(pool)) {
+                continue;
+            }
+            pool_lock(pool);
+            ptr = block_alloc_aligned(pool, alignment, size);
+            pool_unlock(pool);
+        }
+        if (ptr == NULL && !pressure_relieved(size, attempt)) {
+            return NULL;
+        }
+    }
+    return ptr;
+}
+
+// Returns the size of an allocated block
+// Parameters:
+// - ptr: a pointer returned by one of the allocation functions.
+// Returns:
+// - The size of the block, or 0 if ptr is not the start of an allocated block.
+size_t mem_usable_size(const void* ptr) {
+    Pool* pool = pool_of(ptr);
+    if (!pool) {
+        return 0;
+    }
+
+    size_t size = 0;
+    pool_lock(pool);
+    if (pool->granule) {
+        size = bitmap_usable_size(pool, ptr);
+    } else {
+        BlockId block = block_at(pool, ptr);
+        if (block != BLOCK_NIL && !pool->blocks.is_free[block]) {
+            size = pool->blocks.size[block];
+        }
+    }
+    pool_unlock(pool);
+    return size;
+}
+
+// Returns true if ptr lies inside memory managed by the allocator.
+bool mem_owns(const void* ptr) {
+    return pool_of(ptr) != NULL;
+}
+
+// Adds another region of size bytes to the memory pool
+// Allocations that no longer fit the existing regions are served from it. The region is
+// mapped with mmap and nothing is malloc'd, so this may be called before mem_init to
+// create the first region.
+// Parameters:
+// - size: the size of the region.
+// Returns:
+// - 0 on success, -1 if the region cannot be mapped or MAX_POOLS regions exist already.
+// Thread safety:
+// - Safe to call concurrently with the allocation functions.
+int mem_grow(size_t size) {
+    return mem_grow_hint(size, MEM_LONG_LIVED);
+}
+
+// Adds another region of size bytes for allocations of the given lifetime
+// A MEM_SHORT_LIVED region is a sub-pool only mem_alloc_hint(size, MEM_SHORT_LIVED)
+// allocates from (see mem_alloc_hint); its free space is returned to the kernel as it
+// empties. A MEM_LONG_LIVED region is a general one, as added by mem_grow.
+// Parameters:
+// - size: the size of the region.
+// - lifetime: the requests the region serves.
+// Returns:
+// - 0 on success, -1 if the region cannot be mapped or MAX_POOLS regions exist already.
+// Thread safety:
+// - Safe to call concurrently with the allocation functions.
+int mem_grow_hint(size_t size, MemLifetime lifetime) {
+    pthread_mutex_lock(&grow_lock);
+    int count = atomic_load(&pool_count);
+    if (count == MAX_POOLS) {
+        pthread_mutex_unlock(&grow_lock);
+        return -1;
+    }
+
+    void* base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        pthread_mutex_unlock(&grow_lock);
+        return -1;
+    }
+    int node = count > 0 ? pools[0].node : 0;
+    int memory_node = count > 0 ? pools[0].memory_node : 0;
+    if (!pool_setup(&pools[count], base, size, true, node, memory_node, true)) {
+        munmap(base, size);
+        pthread_mutex_unlock(&grow_lock);
+        return -1;
+    }
+    pools[count].lifetime = lifetime;
+
+    // Publish the pool only once it is set up
+    atomic_store(&pool_count, count + 1);
+    pthread_mutex_unlock(&grow_lock);
+    return 0;
+}
+
+// Selects where allocations are placed within a pool
+// - MEM_FIRST_FIT: the lowest-addressed free block that fits (the default).
+// - MEM_NEXT_FIT: the first block that fits after where the previous search ended.
+// - MEM_BEST_FIT: the smallest block that fits, from a size-ordered tree in O(log n).
+// - MEM_WORST_FIT: the largest free block, from the same tree.
+// Parameters:
+// - policy: the policy for all current pools and pools set up later.
+// Thread safety:
+// - Safe to call concurrently with the allocation functions.
+void mem_set_policy(MemPolicy policy) {
+    atomic_store(&default_policy, policy);
+    int count = atomic_load(&pool_count);
+    for (int i = 0; i < count; i++) {
+        pool_lock(&pools[i]);
+        pool_set_policy(&pools[i], policy);
+        pool_unlock(&pools[i]);
+    }
+}
+
+// Collects fragmentation statistics over all pools
+// Parameters:
+// - stats: receives the totals.
+// Thread safety:
+// - Safe to call concurrently with the allocation functions; each pool is read under its lock.
+void mem_get_stats(MemStats* stats) {
+    memset(stats, 0, sizeof(*stats));
+    int count = atomic_load(&pool_count);
+    for (int i = 0; i < count; i++) {
+        pool_lock(&pools[i]);
+        if (pools[i].granule) {
+            bitmap_stats(&pools[i], stats);
+        }
+        const BlockTable* t = &pools[i].blocks;
+        for (BlockId id = pools[i].head; id != BLOCK_NIL; id = t->next[id]) {
+            if (t->is_free[id]) {
+                stats->free_bytes += t->size[id];
+                stats->free_blocks++;
+                if (t->size[id] > stats->largest_free) {
+                    stats->largest_free = t->size[id];
+                }
+            } else {
+                stats->used_bytes += t->size[id];
+                stats->used_blocks++;
+            }
+        }
+        pool_unlock(&pools[i]);
+    }
+}
+
+// ********* Relocatable handles *********
+
+// Blocks allocated through mem_handle_alloc are reached through a handle, and may be
+// moved by compaction while no one holds them locked. Compaction slides such blocks
+// down into the free space in front of them, so free space collects in larger blocks
+// behind them; plain blocks and locked handles stay where they are.
+
+// One handle: the current address of its block and how often it is locked.
+typedef struct HandleEntry {
+    void* ptr;             // The block, or NULL for an unused entry
+    uint32_t locks;        // Outstanding mem_handle_lock calls
+    uint32_t next_free;    // Unused entries: next unused entry, or 0
+} HandleEntry;
+
+#define HANDLE_TABLE_MIN 256
+
+// Handles index this table, from 1 (0 is MEM_HANDLE_NULL). It is mapped with mmap and
+// grows by doubling. handle_lock guards it and is held across compaction, so lock and
+// unlock never see a block half moved; it is always taken before a pool lock.
+static HandleEntry* handle_table = NULL;
+static uint32_t handle_capacity = 0;
+static uint32_t handle_used = 0;          // Entries handed out at least once
+static uint32_t handle_free = 0;          // First unused entry, or 0
+static pthread_mutex_t handle_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Returns the entry of a handle, or NULL with a warning if it is not in use (caller
+// holds handle_lock).
+static HandleEntry* handle_entry(MemHandle handle, const char* action) {
+    if (handle == MEM_HANDLE_NULL || handle > handle_used || handle_table[handle - 1].ptr == NULL) {
+        fprintf(stderr, "Warning: Attempted to %s an invalid handle %u.\n", action, handle);
+        return NULL;
+    }
+    return &handle_table[handle - 1];
+}
+
+// Takes an unused handle, growing the table when it is full (caller holds handle_lock).
+// Returns:
+// - The handle, or MEM_HANDLE_NULL if the table cannot grow.
+static MemHandle handle_new(void) {
+    if (handle_free != 0) {
+        MemHandle handle = handle_free;
+        handle_free = handle_table[handle - 1].next_free;
+        return handle;
+    }
+    if (handle_used == handle_capacity) {
+        if (handle_capacity > UINT32_MAX / 2) {
+            return MEM_HANDLE_NULL;
+        }
+        uint32_t capacity = handle_capacity ? handle_capacity * 2 : HANDLE_TABLE_MIN;
+        HandleEntry* table = (HandleEntry*)mmap(NULL, capacity * sizeof(HandleEntry), PROT_READ | PROT_WRITE,
+                                                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (table == MAP_FAILED) {
+            return MEM_HANDLE_NULL;
+        }
+        if (handle_table) {
+            memcpy(table, handle_table, handle_used * sizeof(HandleEntry));
+            munmap(handle_table, handle_capacity * sizeof(HandleEntry));
+        }
+        handle_table = table;
+        handle_capacity = capacity;
+    }
+    return ++handle_used;
+}
+
+// Slides unlocked handle blocks of a block list pool down into the free blocks in front
+// of them until budget bytes have been moved (caller holds handle_lock and pool->lock).
+// Returns:
+// - The number of bytes moved.
+static size_t pool_compact(Pool* pool, size_t budget) {
+    BlockTable* t = &pool->blocks;
+    size_t moved = 0;
+    BlockId prev = BLOCK_NIL;
+    BlockId current = pool->head;
+    while (current != BLOCK_NIL && moved < budget) {
+        BlockId next_block = t->next[current];
+        if (!t->is_free[current] || next_block == BLOCK_NIL || t->is_free[next_block] ||
+            t->handle[next_block] == 0 || handle_table[t->handle[next_block] - 1].locks > 0) {
+            prev = current;
+            current = next_block;
+            continue;
+        }
+
+        // Swap the free block and the handle block after it: the data moves down, the
+        // free space up, where it merges with a free block that follows
+        free_index_remove(pool, current);
+        size_t free_offset = t->offset[current];
+        memmove(pool->base + free_offset, block_ptr(pool, next_block), t->size[next_block]);
+        moved += t->size[next_block];
+        t->offset[next_block] = free_offset;
+        t->offset[current] = free_offset + t->size[next_block];
+        t->clean[current] = t->size[current];
+        handle_table[t->handle[next_block] - 1].ptr = block_ptr(pool, next_block);
+
+        t->next[current] = t->next[next_block];
+        t->next[next_block] = current;
+        if (prev == BLOCK_NIL) {
+            pool->head = next_block;
+        } else {
+            t->next[prev] = next_block;
+        }
+        while (next_is_free(pool, current)) {
+            block_merge_next(pool, current);
+        }
+        block_purge(pool, current);
+        free_index_insert(pool, current);
+        // The free block may now be followed by another handle block
+        prev = next_block;
+    }
+    return moved;
+}
+
+// Compacts every block list pool until budget bytes have been moved (caller holds
+// handle_lock).
+static size_t pools_compact(size_t budget) {
+    size_t moved = 0;
+    int count = atomic_load(&pool_count);
+    for (int i = 0; i < count && moved < budget; i++) {
+        if (pools[i].granule || pools[i].shared) {
+            continue;  // Bitmap pools do not move blocks; other processes may use shared ones
+        }
+        pool_lock(&pools[i]);
+        moved += pool_compact(&pools[i], budget - moved);
+        pool_unlock(&pools[i]);
+    }
+    return moved;
+}
+
+// Allocates a relocatable block of the specified size
+// The block is reached through mem_handle_lock, which pins it while it is used. If no
+// free block is large enough, the pools are compacted and the allocation retried.
+// Parameters:
+// - size: the size of the memory to allocate.
+// Returns:
+// - The handle, or MEM_HANDLE_NULL if the memory cannot be found even after compaction.
+// Thread safety:
+// - Safe to call concurrently with the other allocation functions.
+MemHandle mem_handle_alloc(size_t size) {
+    pthread_mutex_lock(&handle_lock);
+    // The pressure handler is not called here: it may compact, which takes handle_lock
+    void* ptr = pools_alloc(size, MEM_LONG_LIVED);
+    if (!ptr && pools_compact(SIZE_MAX) > 0) {
+        ptr = pools_alloc(size, MEM_LONG_LIVED);
+    }
+    MemHandle handle = ptr ? handle_new() : MEM_HANDLE_NULL;
+    if (handle == MEM_HANDLE_NULL) {
+        if (ptr) {
+            mem_free(ptr);
+        }
+        pthread_mutex_unlock(&handle_lock);
+        return MEM_HANDLE_NULL;
+    }
+    handle_table[handle - 1] = (HandleEntry){ .ptr = ptr, .locks = 0, .next_free = 0 };
+
+    // Mark the block movable; blocks in bitmap and shared pools never move
+    Pool* pool = pool_of(ptr);
+    if (!pool->granule && !pool->shared) {
+        pool_lock(pool);
+        pool->blocks.handle[block_at(pool, ptr)] = handle;
+        pool_unlock(pool);
+    }
+    pthread_mutex_unlock(&handle_lock);
+    return handle;
+}
+
+// Frees a block allocated with mem_handle_alloc and retires its handle
+// Parameters:
+// - handle: the handle; it must not be locked.
+// Errors:
+// - Prints a warning and does nothing if the handle is invalid or still locked.
+void mem_handle_free(MemHandle handle) {
+    pthread_mutex_lock(&handle_lock);
+    HandleEntry* entry = handle_entry(handle, "free");
+    if (entry && entry->locks > 0) {
+        fprintf(stderr, "Warning: Attempted to free locked handle %u.\n", handle);
+        entry = NULL;
+    }
+    if (entry) {
+        mem_free(entry->ptr);
+        entry->ptr = NULL;
+        entry->next_free = handle_free;
+        handle_free = handle;
+    }
+    pthread_mutex_unlock(&handle_lock);
+}
+
+// Pins a handle's block and returns its current address
+// The address stays valid until the matching mem_handle_unlock; locks nest.
+// Parameters:
+// - handle: a handle from mem_handle_alloc.
+// Returns:
+// - The block's address, or NULL if the handle is invalid.
+void* mem_handle_lock(MemHandle handle) {
+    pthread_mutex_lock(&handle_lock);
+    HandleEntry* entry = handle_entry(handle, "lock");
+    void* ptr = NULL;
+    if (entry) {
+        entry->locks++;
+        ptr = entry->ptr;
+    }
+    pthread_mutex_unlock(&handle_lock);
+    return ptr;
+}
+
+// Releases one lock on a handle; once it is unlocked, compaction may move its block.
+// Errors:
+// - Prints a warning if the handle is invalid or not locked.
+void mem_handle_unlock(MemHandle handle) {
+    pthread_mutex_lock(&handle_lock);
+    HandleEntry* entry = handle_entry(handle, "unlock");
+    if (entry && entry->locks == 0) {
+        fprintf(stderr, "Warning: Attempted to unlock handle %u, which is not locked.\n", handle);
+    } else if (entry) {
+        entry->locks--;
+    }
+    pthread_mutex_unlock(&handle_lock);
+}
+
+// Runs an incremental compaction pass
+// Unlocked handle blocks are slid down into the free space before them, which merges
+// free blocks behind them. Calling it with a small budget from time to time, or from a
+// background thread, bounds the pause each call causes.
+// Parameters:
+// - budget: the number of bytes to move at most (the pass stops after the block that
+//   reaches it); SIZE_MAX compacts fully.
+// Returns:
+// - The number of bytes moved; 0 means the pools are as compact as handles allow.
+// Thread safety:
+// - Safe to call concurrently with the other allocation functions.
+size_t mem_compact(size_t budget) {
+    pthread_mutex_lock(&handle_lock);
+    size_t moved = pools_compact(budget);
+    pthread_mutex_unlock(&handle_lock);
+    return moved;
+}
+
+// ********* NUMA-aware pools *********
+
+// mem_init_numa creates one pool per NUMA node and sets a memory policy on its pages
+// before they are first touched, so they are placed on that node whichever thread
+// faults them in. The policy calls go through syscall() directly; libnuma is not needed.
+
+#ifndef MPOL_DEFAULT
+#define MPOL_DEFAULT 0
+#define MPOL_PREFERRED 1
+#endif
+
+#define NUMA_MAX_NODES 1024                              // Bits in a node mask
+#define NUMA_WORD_BITS (8 * sizeof(unsigned long))
+#define NUMA_MASK_WORDS (NUMA_MAX_NODES / NUMA_WORD_BITS)
+
+// Reads the online NUMA nodes from sysfs ("0", "0-1", "0,2-3", ...).
+// Returns:
+// - The number of node ids stored in nodes; 1 (node 0) if the topology cannot be read.
+static int numa_online_nodes(int* nodes, int max) {
+    int count = 0;
+    FILE* file = fopen("/sys/devices/system/node/online", "r");
+    if (file) {
+        int first;
+        while (count < max && fscanf(file, "%d", &first) == 1) {
+            int last = first;
+            int c = fgetc(file);
+            if (c == '-') {
+                if (fscanf(file, "%d", &last) != 1) {
+                    break;
+                }
+                c = fgetc(file);
+            }
+            for (int node = first; node <= last && count < max; node++) {
+                nodes[count++] = node;
+            }
+            if (c != ',') {
+                break;
+            }
+        }
+        fclose(file);
+    }
+    if (count == 0) {
+        nodes[0] = 0;
+        count = 1;
+    }
+    return count;
+}
+
+// Fills a node mask with a single node.
+static void numa_mask(unsigned long* mask, int node) {
+    memset(mask, 0, NUMA_MASK_WORDS * sizeof(unsigned long));
+    mask[node / NUMA_WORD_BITS] = 1UL << (node % NUMA_WORD_BITS);
+}
+
+// Makes the pages of [base, base + size) prefer a node. MPOL_PREFERRED rather than
+// MPOL_BIND, so a full node spills over to another one instead of failing page faults.
+// Returns:
+// - 0 on success, -1 with errno set if the kernel refuses (e.g. built without NUMA).
+static int numa_bind(void* base, size_t size, int node) {
+    unsigned long mask[NUMA_MASK_WORDS];
+    numa_mask(mask, node);
+    return (int)syscall(SYS_mbind, base, size, MPOL_PREFERRED, mask, NUMA_MAX_NODES, 0);
+}
+
+// Initializes one memory pool per NUMA node
+// Every pool is mapped separately and its pages are bound to its node. Threads allocate
+// from the pool of the node they run on and fall back to the other pools when it is
+// full; mem_free returns a block to the pool it came from.
+// Setting MEM_NUMA_FAKE_NODES=n in the environment creates n pools regardless of the
+// hardware (their pages spread over the real nodes), which exercises the multi-pool
+// paths on single-socket machines.
+// Parameters:
+// - size_per_node: the size of every node's pool.
+// Returns:
+// - The number of pools (nodes).
 // Errors:
-// - Prints an error message and exits if memory allocation fails.
-void mem_init(size_t size) {
-    memory_pool = malloc(size);
-    if (!memory_pool) {
-        perror("Memory pool allocation failed");
-        exit(EXIT_FAILURE);
+// - Prints an error message and exits if a pool cannot be mapped.
+// - Prints a warning and leaves placement to the kernel if binding a pool fails.
+int mem_init_numa(size_t size_per_node) {
+    int nodes[MAX_POOLS];
+    int online = numa_online_nodes(nodes, MAX_POOLS);
+    int count = online;
+    const char* fake = getenv("MEM_NUMA_FAKE_NODES");
+    if (fake && atoi(fake) > 0) {
+        count = atoi(fake) < MAX_POOLS ? atoi(fake) : MAX_POOLS;
     }
 
-    memory_pool_size = size;
+    for (int i = 0; i < count; i++) {
+        void* base = mmap(NULL, size_per_node, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED) {
+            perror("NUMA pool allocation failed");
+            exit(EXIT_FAILURE);
+        }
 
-    // Allocate the initial metadata block for managing the memory pool
-    head_block = (Block*)malloc(sizeof(Block));
-    if (!head_block) {
-        perror("Block metadata allocation failed");
-        free(memory_pool);
-        exit(EXIT_FAILURE);
+        int memory_node = nodes[i % online];
+        if (memory_node < NUMA_MAX_NODES && numa_bind(base, size_per_node, memory_node) != 0) {
+            fprintf(stderr, "Warning: Binding the pool of node %d failed: %s.\n", memory_node, strerror(errno));
+        }
+        if (!pool_setup(&pools[i], base, size_per_node, true, count == online ? memory_node : i, memory_node, true)) {
+            perror("Block metadata allocation failed");
+            exit(EXIT_FAILURE);
+        }
     }
 
-    head_block->size = size;  // The size of the entire pool
-    head_block->is_free = 1;  // The entire pool is initially free
-    head_block->ptr = memory_pool;  // Points to the start of the pool
-    head_block->next = NULL;
+    atomic_store(&pool_count, count);
+    atomic_fetch_add(&mem_pool_generation, 1);
+    return count;
 }
 
-// Allocates a block of memory of the specified size
+// Chooses the node the calling thread allocates from, overriding the node it runs on,
+// and sets the thread's memory policy to prefer it for its other allocations too.
 // Parameters:
-// - size: the size of the memory to allocate.
+// - node: a node returned by mem_numa_node_of, or -1 to go back to the running node.
+// Errors:
+// - Prints a warning and keeps the current choice if no pool serves the node.
+void mem_numa_set_node(int node) {
+    if (node < 0) {
+        numa_self_generation = 0;
+        syscall(SYS_set_mempolicy, MPOL_DEFAULT, NULL, 0);
+        return;
+    }
+
+    int index = -1;
+    for (int i = 0; i < pool_count; i++) {
+        if (pools[i].node == node) {
+            index = i;
+        }
+    }
+    if (index < 0) {
+        fprintf(stderr, "Warning: No pool for NUMA node %d.\n", node);
+        return;
+    }
+
+    numa_self = index;
+    numa_self_generation = atomic_load(&mem_pool_generation);
+    if (pools[index].memory_node < NUMA_MAX_NODES) {
+        // Only a preference: failing here just leaves placement to the kernel.
+        unsigned long mask[NUMA_MASK_WORDS];
+        numa_mask(mask, pools[index].memory_node);
+        syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask, NUMA_MAX_NODES);
+    }
+}
+
+// Returns the NUMA node of the pool a block was allocated from.
 // Returns:
-// - A pointer to the allocated memory if successful, or NULL if no suitable block is found.
-void* mem_alloc(size_t size) {
-    Block* current = head_block;
-
-    // Find the first free block that is large enough
-    while (current != NULL) {
-        if (current->is_free && current->size >= size) {
-            // If the block is larger than needed, split it
-            if (current->size > size) {
-                // Create a new metadata block for the remaining free memory
-                Block* new_block = (Block*)malloc(sizeof(Block));
-                if (!new_block) {
-                    perror("New block metadata allocation failed");
-                    return NULL;
-                }
+// - The node, or -1 if ptr is not inside any pool.
+int mem_numa_node_of(const void* ptr) {
+    Pool* pool = pool_of(ptr);
+    return pool ? pool->node : -1;
+}
 
-                new_block->size = current->size - size;
-                new_block->is_free = 1;
-                new_block->ptr = (char*)current->ptr + size;
-                new_block->next = current->next;
+// ********* Metadata slabs *********
 
-                current->size = size;
-                current->is_free = 0;
-                current->next = new_block;
-            } else {
-                current->is_free = 0;
+// Bookkeeping that the allocator creates while in use (epoch records, thread caches and
+// magazines) is carved from mmap'd slabs of fixed-size objects instead of malloc, so no
+// libc allocation happens after mem_init. Released objects go on a free list and are
+// reused; slab memory is never unmapped.
+
+#define META_SLAB_BYTES (64 * 1024)
+
+typedef struct MetaSlab {
+    size_t object_size;    // Object size, a multiple of CACHE_LINE
+    void* free_list;       // Released objects, linked through their first word
+    char* bump;            // Next unused byte of the current slab
+    char* end;             // End of the current slab
+    pthread_mutex_t lock;
+} MetaSlab;
+
+#define META_SLAB(type) { (sizeof(type) + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE, NULL, NULL, NULL, PTHREAD_MUTEX_INITIALIZER }
+
+// Takes a zeroed object from a slab, mapping a new slab when the current one is used up.
+// Returns:
+// - The object, or NULL with errno set if no slab can be mapped.
+static void* meta_alloc(MetaSlab* slab) {
+    pthread_mutex_lock(&slab->lock);
+    void* object = slab->free_list;
+    if (object) {
+        memcpy(&slab->free_list, object, sizeof(void*));
+    } else {
+        if (slab->bump == NULL || (size_t)(slab->end - slab->bump) < slab->object_size) {
+            size_t bytes = slab->object_size > META_SLAB_BYTES ? slab->object_size : META_SLAB_BYTES;
+            char* mapping = (char*)mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (mapping == MAP_FAILED) {
+                pthread_mutex_unlock(&slab->lock);
+                return NULL;
             }
+            slab->bump = mapping;
+            slab->end = mapping + bytes;
+        }
+        object = slab->bump;
+        slab->bump += slab->object_size;
+    }
+    pthread_mutex_unlock(&slab->lock);
+    memset(object, 0, slab->object_size);
+    return object;
+}
 
-            // Return the pointer to the allocated memory
-            return current->ptr;
+// Returns an object to its slab.
+static void meta_free(MetaSlab* slab, void* object) {
+    if (!object) {
+        return;
+    }
+    pthread_mutex_lock(&slab->lock);
+    memcpy(object, &slab->free_list, sizeof(void*));
+    slab->free_list = object;
+    pthread_mutex_unlock(&slab->lock);
+}
+
+// ********* Deferred reclamation (epoch based) *********
+
+// Number of retired blocks a thread collects before it tries to reclaim them.
+#define EPOCH_BATCH 64
+
+// Initial length of a retired list (one 4 KiB page); it doubles when full.
+#define EPOCH_RETIRED_MIN 256
+
+// A block handed to mem_retire, tagged with the global epoch at retirement.
+typedef struct RetiredBlock {
+    void* ptr;
+    uint64_t epoch;
+} RetiredBlock;
+
+// Per-thread reclamation state. Records are never freed: a thread that exits gives
+// its record up and a later thread adopts it, together with any blocks still pending.
+typedef struct EpochRecord {
+    atomic_uint_fast64_t epoch;   // Global epoch observed when the critical section began
+    atomic_int active;            // 1 while the owner is inside a critical section
+    atomic_int owned;             // 1 while a thread uses the record
+    int depth;                    // Nesting depth of mem_epoch_enter (owner only)
+    RetiredBlock* retired;        // Blocks waiting for a grace period, oldest first
+    size_t retired_count;         // Number of pending blocks
+    size_t retired_slots;         // Mapped length of retired
+    struct EpochRecord* next;     // Next record in epoch_records
+} EpochRecord;
+
+static MetaSlab epoch_slab = META_SLAB(EpochRecord);
+
+static atomic_uint_fast64_t global_epoch = 0;
+static _Atomic(EpochRecord*) epoch_records = NULL;
+static __thread EpochRecord* epoch_self = NULL;
+static pthread_key_t epoch_key;
+static pthread_once_t epoch_key_once = PTHREAD_ONCE_INIT;
+
+// Gives the exiting thread's record up for adoption.
+static void epoch_thread_exit(void* arg) {
+    EpochRecord* record = (EpochRecord*)arg;
+    atomic_store(&record->active, 0);
+    record->depth = 0;
+    atomic_store(&record->owned, 0);
+}
+
+static void epoch_key_create(void) {
+    pthread_key_create(&epoch_key, epoch_thread_exit);
+}
+
+// Returns the calling thread's record, adopting an abandoned one or creating a new one.
+// Returns:
+// - The record, or NULL if a new record cannot be allocated.
+static EpochRecord* epoch_record(void) {
+    if (epoch_self) {
+        return epoch_self;
+    }
+    pthread_once(&epoch_key_once, epoch_key_create);
+
+    EpochRecord* record;
+    for (record = atomic_load(&epoch_records); record != NULL; record = record->next) {
+        int expected = 0;
+        if (atomic_compare_exchange_strong(&record->owned, &expected, 1)) {
+            break;
+        }
+    }
+    if (!record) {
+        record = (EpochRecord*)meta_alloc(&epoch_slab);
+        if (!record) {
+            perror("Epoch record allocation failed");
+            return NULL;
+        }
+        atomic_store(&record->owned, 1);
+        EpochRecord* head = atomic_load(&epoch_records);
+        do {
+            record->next = head;
+        } while (!atomic_compare_exchange_weak(&epoch_records, &head, record));
+    }
+    pthread_setspecific(epoch_key, record);
+    epoch_self = record;
+    return record;
+}
+
+// Advances the global epoch if every thread inside a critical section has observed it.
+static void epoch_try_advance(void) {
+    uint64_t epoch = atomic_load(&global_epoch);
+    for (EpochRecord* record = atomic_load(&epoch_records); record != NULL; record = record->next) {
+        if (atomic_load(&record->active) && atomic_load(&record->epoch) != epoch) {
+            return;
         }
+    }
+    atomic_compare_exchange_strong(&global_epoch, &epoch, epoch + 1);
+}
+
+// Frees the blocks of a record whose grace period has elapsed: a block retired in epoch e
+// can no longer be referenced once the global epoch reaches e + 2. All of them are
+// returned with one block_free_many per pool, each under a single acquisition of its lock.
+static void epoch_reclaim_record(EpochRecord* record) {
+    uint64_t epoch = atomic_load(&global_epoch);
+    size_t done = 0;
+    while (done < record->retired_count && record->retired[done].epoch + 2 <= epoch) {
+        done++;
+    }
+    if (done == 0) {
+        return;
+    }
 
-        current = current->next;
+    // The pointers are packed into the front of the list itself: pointer i lands on entry
+    // i / 2, which has been read already, and the entries from done on are not touched.
+    void** ptrs = (void**)record->retired;
+    for (size_t i = 0; i < done; i++) {
+        void* ptr = record->retired[i].ptr;
+        ptrs[i] = ptr;
     }
+    pools_free_many(ptrs, done);
 
-    // If no suitable block is found, return NULL (allocation failure)
-    return NULL;
+    memmove(record->retired, record->retired + done, (record->retired_count - done) * sizeof(RetiredBlock));
+    record->retired_count -= done;
 }
 
-// Frees a previously allocated block of memory
+// Doubles the retired list of a record, moving it to a new mapping as table_grow does.
+// Returns:
+// - true on success, false if the new list cannot be mapped.
+static bool epoch_retired_grow(EpochRecord* record) {
+    size_t slots = record->retired_slots ? record->retired_slots * 2 : EPOCH_RETIRED_MIN;
+    RetiredBlock* retired = (RetiredBlock*)mmap(NULL, slots * sizeof(RetiredBlock), PROT_READ | PROT_WRITE,
+                                                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (retired == MAP_FAILED) {
+        return false;
+    }
+    if (record->retired) {
+        memcpy(retired, record->retired, record->retired_count * sizeof(RetiredBlock));
+        munmap(record->retired, record->retired_slots * sizeof(RetiredBlock));
+    }
+    record->retired = retired;
+    record->retired_slots = slots;
+    return true;
+}
+
+// Drops every pending block without freeing it (the pool itself is going away).
+static void epoch_discard_retired(void) {
+    for (EpochRecord* record = atomic_load(&epoch_records); record != NULL; record = record->next) {
+        record->retired_count = 0;
+    }
+}
+
+// Marks the start of a read-side critical section. Blocks retired by any thread after
+// this call are not freed until the caller leaves the section. Sections may nest.
+// Errors:
+// - Prints an error message if the thread's epoch record cannot be allocated.
+void mem_epoch_enter(void) {
+    EpochRecord* record = epoch_record();
+    if (!record || record->depth++ > 0) {
+        return;
+    }
+    atomic_store(&record->active, 1);
+    atomic_store(&record->epoch, atomic_load(&global_epoch));
+}
+
+// Marks the end of a read-side critical section started with mem_epoch_enter.
+void mem_epoch_exit(void) {
+    EpochRecord* record = epoch_self;
+    if (!record || record->depth == 0 || --record->depth > 0) {
+        return;
+    }
+    atomic_store(&record->active, 0);
+}
+
+// Defers freeing a block until no thread can still be reading it. Threads that may hold
+// a reference must access the block inside mem_epoch_enter/mem_epoch_exit. Retired blocks
+// are collected per thread and freed in batches.
 // Parameters:
 // - ptr: the pointer to the memory to be freed.
 // Errors:
-// - Ignores attempts to free NULL pointers.
-// - Prints a warning if the pointer does not correspond to any allocated block.
-void mem_free(void* ptr) {
+// - Ignores NULL pointers.
+// - Frees the block immediately (unsafe for concurrent readers) with a warning if the
+//   bookkeeping cannot be allocated.
+void mem_retire(void* ptr) {
     if (!ptr) {
-        fprintf(stderr, "Warning: Attempted to free a NULL pointer.\n");
         return;
     }
 
-    // Find the block metadata corresponding to the pointer
-    Block* current = head_block;
-    while (current != NULL) {
-        if (current->ptr == ptr) {
-            if (current->is_free) {
-                fprintf(stderr, "Warning: Attempted to free an already freed block at %p.\n", ptr);
-                return;
+    EpochRecord* record = epoch_record();
+    if (!record || (record->retired_count == record->retired_slots && !epoch_retired_grow(record))) {
+        fprintf(stderr, "Warning: Retire list allocation failed, freeing %p immediately.\n", ptr);
+        mem_free(ptr);
+        return;
+    }
+
+    record->retired[record->retired_count].ptr = ptr;
+    record->retired[record->retired_count].epoch = atomic_load(&global_epoch);
+    record->retired_count++;
+
+    if (record->retired_count % EPOCH_BATCH == 0) {
+        epoch_try_advance();
+        epoch_reclaim_record(record);
+    }
+}
+
+// Frees every retired block whose grace period has elapsed, including blocks left
+// behind by threads that have exited. Blocks still protected by a critical section stay
+// pending.
+void mem_reclaim(void) {
+    // Two advances are enough for everything retired before this call to become free.
+    epoch_try_advance();
+    epoch_try_advance();
+
+    EpochRecord* self = epoch_record();
+    for (EpochRecord* record = atomic_load(&epoch_records); record != NULL; record = record->next) {
+        int expected = 0;
+        if (record == self) {
+            epoch_reclaim_record(record);
+        } else if (atomic_compare_exchange_strong(&record->owned, &expected, 1)) {
+            epoch_reclaim_record(record);
+            atomic_store(&record->owned, 0);
+        }
+    }
+}
+
+// ********* Thread-local magazine caches *********
+
+// Small sizes are served from per-thread magazines (fixed-capacity stacks of blocks of
+// one size class) that are exchanged in bulk with a per-class depot, following Bonwick's
+// magazine design. Only magazine exchanges with the depot and refills/flushes against
+// the pool take a lock. The classes, and how many blocks a magazine of each holds, come
+// from memory_manager_classes.h, generated at build time from SIZE_CLASSES in the Makefile.
+
+#define CACHE_CLASSES MEM_SIZE_CLASSES                  // Number of size classes
+#define DEPOT_MAX_FULL 8                                // Full magazines kept per class
+
+// A stack of free blocks of one size class.
+typedef struct Magazine {
+    int rounds;                         // Number of blocks held
+    void* items[MEM_SIZE_CLASS_MAX_ROUNDS]; // The blocks, top of stack last
+    struct Magazine* next;              // Next magazine in a depot list
+} Magazine;
+
+// Per-class depot shared by all threads.
+typedef struct Depot {
+    pthread_mutex_t lock;
+    Magazine* full;                     // Magazines holding a class capacity of blocks
+    Magazine* empty;                    // Magazines holding no blocks
+    int full_count;                     // Length of the full list
+} Depot;
+
+// Magazines of one thread for one class. Invariant between calls: previous is either
+// full or empty, so it can always absorb a whole magazine's worth of operations.
+typedef struct CacheClass {
+    Magazine* loaded;
+    Magazine* previous;
+} CacheClass;
+
+// Per-thread cache.
+typedef struct ThreadCache {
+    unsigned generation;                // mem_pool_generation the magazines were filled from
+    CacheClass classes[CACHE_CLASSES];
+} ThreadCache;
+
+static Depot depots[CACHE_CLASSES];
+static MetaSlab cache_slab = META_SLAB(ThreadCache);
+static MetaSlab magazine_slab = META_SLAB(Magazine);
+static pthread_once_t cache_once = PTHREAD_ONCE_INIT;
+static pthread_key_t cache_key;
+static __thread ThreadCache* cache_self __attribute__((tls_model("initial-exec"))) = NULL;
+
+// Returns the blocks of a magazine to the pool.
+static void magazine_flush(Magazine* magazine) {
+    if (magazine->rounds > 0) {
+        mem_free_many(magazine->items, (size_t)magazine->rounds);
+        magazine->rounds = 0;
+    }
+}
+
+// Drops all magazines of a thread cache, returning their blocks to the pool if it is
+// still the one they came from.
+static void cache_drop(ThreadCache* cache, bool return_blocks) {
+    for (size_t i = 0; i < CACHE_CLASSES; i++) {
+        Magazine* magazines[2] = { cache->classes[i].loaded, cache->classes[i].previous };
+        for (int m = 0; m < 2; m++) {
+            if (magazines[m]) {
+                if (return_blocks) {
+                    magazine_flush(magazines[m]);
+                }
+                meta_free(&magazine_slab, magazines[m]);
             }
+        }
+        cache->classes[i].loaded = NULL;
+        cache->classes[i].previous = NULL;
+    }
+}
+
+// Flushes the exiting thread's cache.
+static void cache_thread_exit(void* arg) {
+    ThreadCache* cache = (ThreadCache*)arg;
+    cache_drop(cache, cache->generation == atomic_load(&mem_pool_generation));
+    meta_free(&cache_slab, cache);
+}
+
+static void cache_setup(void) {
+    for (size_t i = 0; i < CACHE_CLASSES; i++) {
+        pthread_mutex_init(&depots[i].lock, NULL);
+    }
+    pthread_key_create(&cache_key, cache_thread_exit);
+}
+
+// Returns the calling thread's cache, creating it on first use and dropping magazines
+// filled from a previous pool.
+static ThreadCache* thread_cache(void) {
+    ThreadCache* cache = cache_self;
+    unsigned generation = atomic_load_explicit(&mem_pool_generation, memory_order_relaxed);
+    if (cache && cache->generation == generation) {
+        return cache;
+    }
+    if (cache) {
+        cache_drop(cache, false);
+        cache->generation = generation;
+        return cache;
+    }
+
+    pthread_once(&cache_once, cache_setup);
+    cache = (ThreadCache*)meta_alloc(&cache_slab);
+    if (!cache) {
+        return NULL;
+    }
+    cache->generation = generation;
+    pthread_setspecific(cache_key, cache);
+    cache_self = cache;
+    return cache;
+}
 
-            current->is_free = 1;
+// Child side of fork while a shared pool is open (see mem_init_shared). The child has a
+// copy of the parent's caches, whose blocks the parent goes on handing out, so it must
+// not use them: the new generation makes its thread caches and inline lists drop their
+// contents, and the depots and retired lists are emptied without freeing any block. The
+// depot and metadata slab locks may have been held by other threads of the parent and are
+// set up afresh.
+static void cache_fork_child(void) {
+    if (!pools[0].shared) {
+        return;
+    }
+    for (size_t i = 0; i < CACHE_CLASSES; i++) {
+        depots[i].full = NULL;
+        depots[i].empty = NULL;
+        depots[i].full_count = 0;
+        pthread_mutex_init(&depots[i].lock, NULL);
+    }
+    pthread_mutex_init(&epoch_slab.lock, NULL);
+    pthread_mutex_init(&cache_slab.lock, NULL);
+    pthread_mutex_init(&magazine_slab.lock, NULL);
+    epoch_discard_retired();
+    atomic_fetch_add(&mem_pool_generation, 1);
+}
 
-            // Coalesce adjacent free blocks to prevent fragmentation
-            Block* next_block = current->next;
-            while (next_block != NULL && next_block->is_free) {
-                current->size += next_block->size;
-                current->next = next_block->next;
-                free(next_block);
-                next_block = current->next;
+// Frees the magazines held by the depots (the pool they came from is going away).
+static void cache_discard_depots(void) {
+    pthread_once(&cache_once, cache_setup);
+    for (size_t i = 0; i < CACHE_CLASSES; i++) {
+        Depot* depot = &depots[i];
+        pthread_mutex_lock(&depot->lock);
+        Magazine* lists[2] = { depot->full, depot->empty };
+        for (int l = 0; l < 2; l++) {
+            while (lists[l]) {
+                Magazine* next = lists[l]->next;
+                meta_free(&magazine_slab, lists[l]);
+                lists[l] = next;
             }
+        }
+        depot->full = NULL;
+        depot->empty = NULL;
+        depot->full_count = 0;
+        pthread_mutex_unlock(&depot->lock);
+    }
+}
 
-            return;
+// Refills the thread's magazines for a class when the loaded one is empty.
+// Returns:
+// - true if the loaded magazine holds at least one block afterwards.
+static bool cache_refill(CacheClass* c, size_t class_index) {
+    if (c->previous && c->previous->rounds > 0) {
+        Magazine* swap = c->loaded;
+        c->loaded = c->previous;
+        c->previous = swap;
+        return true;
+    }
+
+    // Exchange the empty previous magazine for a full one from the depot.
+    Depot* depot = &depots[class_index];
+    pthread_mutex_lock(&depot->lock);
+    if (depot->full) {
+        Magazine* full = depot->full;
+        depot->full = full->next;
+        depot->full_count--;
+        if (c->previous) {
+            c->previous->next = depot->empty;
+            depot->empty = c->previous;
+        }
+        c->previous = c->loaded;
+        c->loaded = full;
+        pthread_mutex_unlock(&depot->lock);
+        return true;
+    }
+    pthread_mutex_unlock(&depot->lock);
+
+    // The depot is dry: fill the loaded magazine straight from the pool in one batch.
+    if (!c->loaded) {
+        c->loaded = (Magazine*)meta_alloc(&magazine_slab);
+        if (!c->loaded) {
+            return false;
         }
+    }
+    c->loaded->rounds = (int)pools_alloc_many(mem_size_class_bytes[class_index], mem_size_class_rounds[class_index], c->loaded->items);
+    return c->loaded->rounds > 0;
+}
+
+// Makes room in the thread's magazines for a class when the loaded one is full.
+// Returns:
+// - true if the loaded magazine has room for at least one block afterwards.
+static bool cache_make_room(CacheClass* c, size_t class_index) {
+    if (!c->loaded) {
+        c->loaded = (Magazine*)meta_alloc(&magazine_slab);
+        return c->loaded != NULL;
+    }
+    if (c->previous && c->previous->rounds == 0) {
+        Magazine* swap = c->loaded;
+        c->loaded = c->previous;
+        c->previous = swap;
+        return true;
+    }
 
-        current = current->next;
+    // Hand the full previous magazine to the depot and take an empty one back.
+    Depot* depot = &depots[class_index];
+    Magazine* overflow = NULL;
+    pthread_mutex_lock(&depot->lock);
+    if (c->previous) {
+        c->previous->next = depot->full;
+        depot->full = c->previous;
+        depot->full_count++;
+        if (depot->full_count > DEPOT_MAX_FULL) {
+            // Too many idle blocks parked in the depot: give one magazine back to the pool.
+            overflow = depot->full;
+            depot->full = overflow->next;
+            depot->full_count--;
+        }
+    }
+    c->previous = c->loaded;
+    c->loaded = depot->empty;
+    if (c->loaded) {
+        depot->empty = c->loaded->next;
     }
+    pthread_mutex_unlock(&depot->lock);
 
-    fprintf(stderr, "Warning: Pointer %p not found in the memory pool.\n", ptr);
+    if (overflow) {
+        magazine_flush(overflow);
+        if (!c->loaded) {
+            c->loaded = overflow;
+            overflow = NULL;
+        }
+        meta_free(&magazine_slab, overflow);
+    }
+    if (!c->loaded) {
+        c->loaded = (Magazine*)meta_alloc(&magazine_slab);
+    }
+    return c->loaded != NULL;
 }
 
-// Resizes a previously allocated block of memory
+// Allocates a block of a size class through the calling thread's magazine cache. The
+// common case pops a block from a thread-local magazine without taking any lock.
 // Parameters:
-// - ptr: the pointer to the memory to resize.
-// - size: the new size for the memory block.
+// - class_index: a class below MEM_SIZE_CLASSES (see memory_manager_classes.h).
 // Returns:
-// - A pointer to the resized memory block if successful, or NULL if resizing fails.
-void* mem_resize(void* ptr, size_t size) {
-    if (!ptr) return mem_alloc(size); // If ptr is NULL, just allocate new memory
-
-    Block* block = head_block;
-    while (block != NULL) {
-        if (block->ptr == ptr) {
-            if (block->size >= size) {
-                // If the current block is already large enough, return the same pointer
-                return ptr;
-            } else {
-                // Allocate a new block and copy the old data to it
-                void* new_ptr = mem_alloc(size);
-                if (new_ptr) {
-                    memcpy(new_ptr, ptr, block->size);
-                    mem_free(ptr);
-                }
-                return new_ptr;
-            }
+// - A pointer to mem_size_class_bytes[class_index] bytes, or NULL if the pool is exhausted.
+// Thread safety:
+// - Safe to call concurrently with the other allocation functions.
+void* mem_cache_alloc_class(unsigned class_index) {
+    ThreadCache* cache = thread_cache();
+    if (!cache) {
+        return mem_alloc(mem_size_class_bytes[class_index]);
+    }
+
+    CacheClass* c = &cache->classes[class_index];
+    for (int attempt = 0;; attempt++) {
+        if ((c->loaded && c->loaded->rounds > 0) || cache_refill(c, class_index)) {
+            return c->loaded->items[--c->loaded->rounds];
+        }
+        // The handler may flush the magazines; the refill starts over after it
+        if (!pressure_relieved(mem_size_class_bytes[class_index], attempt)) {
+            return NULL;
         }
+    }
+}
 
-        block = block->next;
+// Releases a block obtained from mem_cache_alloc_class into the calling thread's
+// magazine cache. The common case pushes the block onto a thread-local magazine without
+// taking any lock.
+// Parameters:
+// - ptr: the pointer to release (NULL is ignored).
+// - class_index: the class passed to mem_cache_alloc_class.
+// Thread safety:
+// - Safe to call concurrently with the other allocation functions, from any thread.
+void mem_cache_free_class(void* ptr, unsigned class_index) {
+    if (!ptr) {
+        return;
+    }
+    ThreadCache* cache = thread_cache();
+    if (!cache) {
+        mem_free(ptr);
+        return;
     }
 
-    fprintf(stderr, "Warning: Pointer %p not found for resizing.\n", ptr);
-    return NULL;  // If the block was not found
+    CacheClass* c = &cache->classes[class_index];
+    if ((c->loaded && c->loaded->rounds < mem_size_class_rounds[class_index]) || cache_make_room(c, class_index)) {
+        c->loaded->items[c->loaded->rounds++] = ptr;
+        return;
+    }
+    mem_free(ptr);
+}
+
+// Allocates a small block through the calling thread's magazine cache.
+// Blocks must be released with mem_cache_free and the same size.
+// Parameters:
+// - size: the size of the memory to allocate. Sizes above MEM_SIZE_CLASS_MAX go to mem_alloc.
+// Returns:
+// - A pointer to at least size bytes, or NULL if the pool is exhausted.
+// Thread safety:
+// - Safe to call concurrently with the other allocation functions.
+void* mem_cache_alloc(size_t size) {
+    return mem_cache_alloc_sized(size);
+}
+
+// Releases a block obtained from mem_cache_alloc into the calling thread's magazine cache.
+// Parameters:
+// - ptr: the pointer to release (NULL is ignored).
+// - size: the size passed to mem_cache_alloc.
+// Thread safety:
+// - Safe to call concurrently with the other allocation functions, from any thread.
+void mem_cache_free(void* ptr, size_t size) {
+    mem_cache_free_sized(ptr, size);
+}
+
+// Returns the blocks cached by the calling thread and by the depots to the pool.
+void mem_cache_flush(void) {
+    ThreadCache* cache = cache_self;
+    if (cache && cache->generation == atomic_load(&mem_pool_generation)) {
+        cache_drop(cache, true);
+    }
+
+    pthread_once(&cache_once, cache_setup);
+    for (size_t i = 0; i < CACHE_CLASSES; i++) {
+        Depot* depot = &depots[i];
+        pthread_mutex_lock(&depot->lock);
+        Magazine* full = depot->full;
+        depot->full = NULL;
+        depot->full_count = 0;
+        pthread_mutex_unlock(&depot->lock);
+        while (full) {
+            Magazine* next = full->next;
+            magazine_flush(full);
+            meta_free(&magazine_slab, full);
+            full = next;
+        }
+    }
+}
+
+// ********* Inline fast path (memory_manager_inline.h) *********
+
+// The thread-local free lists the inline fast paths pop from and push onto. Only their
+// refills and drains, below, go through the pool.
+
+__thread MemInlineCache mem_inline_cache;
+
+static pthread_once_t inline_once = PTHREAD_ONCE_INIT;
+static pthread_key_t inline_key;
+
+// Returns all blocks on a list but the first keep to the pool.
+static void inline_drain(MemInlineList* list, unsigned keep) {
+    void* batch[MEM_SIZE_CLASS_MAX_ROUNDS];
+    while (list->count > keep) {
+        size_t n = 0;
+        while (list->count > keep && n < MEM_SIZE_CLASS_MAX_ROUNDS) {
+            batch[n++] = list->head;
+            list->head = *(void**)list->head;
+            list->count--;
+        }
+        mem_free_many(batch, n);
+    }
+}
+
+// Returns the exiting thread's blocks to the pool.
+static void inline_thread_exit(void* arg) {
+    (void)arg;
+    mem_inline_flush();
+}
+
+static void inline_setup(void) {
+    pthread_key_create(&inline_key, inline_thread_exit);
+}
+
+// Brings the calling thread's lists up to the current pool: lists filled from a previous
+// pool are dropped (their memory is gone) and the thread exit hook is installed.
+static MemInlineCache* inline_cache(void) {
+    MemInlineCache* cache = &mem_inline_cache;
+    unsigned generation = atomic_load(&mem_pool_generation);
+    if (cache->generation != generation) {
+        memset(cache->lists, 0, sizeof(cache->lists));
+        cache->generation = generation;
+    }
+    if (!cache->registered) {
+        pthread_once(&inline_once, inline_setup);
+        pthread_setspecific(inline_key, cache);
+        cache->registered = true;
+    }
+    return cache;
+}
+
+// Refills the calling thread's list of a class with one batch from the pool.
+// Parameters:
+// - class_index: a class below MEM_SIZE_CLASSES.
+// Returns:
+// - A block of the class, or NULL if the pool is exhausted.
+// Thread safety:
+// - Safe to call concurrently with the other allocation functions.
+void* mem_inline_refill(unsigned class_index) {
+    MemInlineList* list = &inline_cache()->lists[class_index];
+    if (list->head) {
+        void* block = list->head;
+        list->head = *(void**)block;
+        list->count--;
+        return block;
+    }
+
+    void* batch[MEM_SIZE_CLASS_MAX_ROUNDS];
+    size_t n = mem_alloc_many(mem_size_class_bytes[class_index], mem_size_class_rounds[class_index], batch);
+    if (n == 0) {
+        return NULL;
+    }
+    // Push in reverse so the list hands the blocks out in address order
+    for (size_t i = n - 1; i > 0; i--) {
+        *(void**)batch[i] = list->head;
+        list->head = batch[i];
+        list->count++;
+    }
+    return batch[0];
+}
+
+// Takes a block onto the calling thread's list of a class, first returning half of a
+// full list to the pool.
+// Parameters:
+// - ptr: the block to release.
+// - class_index: the class the block was allocated with.
+// Thread safety:
+// - Safe to call concurrently with the other allocation functions.
+void mem_inline_overflow(void* ptr, unsigned class_index) {
+    MemInlineList* list = &inline_cache()->lists[class_index];
+    if (list->count >= MEM_INLINE_LIMIT(class_index)) {
+        inline_drain(list, mem_size_class_rounds[class_index]);
+    }
+    *(void**)ptr = list->head;
+    list->head = ptr;
+    list->count++;
+}
+
+// Returns the blocks on the calling thread's inline free lists to the pool.
+void mem_inline_flush(void) {
+    MemInlineCache* cache = &mem_inline_cache;
+    if (cache->generation != atomic_load(&mem_pool_generation)) {
+        return;
+    }
+    for (unsigned i = 0; i < MEM_SIZE_CLASSES; i++) {
+        inline_drain(&cache->lists[i], 0);
+    }
 }
 
 // Deinitializes the memory pool and frees all associated resources
 // Frees the memory pool and all metadata structures, ensuring no memory leaks.
 void mem_deinit() {
-    free(memory_pool);
-    memory_pool = NULL;
+    int count = atomic_load(&pool_count);
+    for (int i = 0; i < count; i++) {
+        Pool* pool = &pools[i];
+        if (pool->file) {
+            pool_file_close(pool);  // Unmaps the block table with the pool memory
+        } else if (pool->mapped) {
+            munmap(pool->base, pool->size);
+        } else {
+            free(pool->base);
+        }
+
+        // The block descriptors all live in the pool's table, or its bitmaps
+        if (pool->granule) {
+            munmap(pool->bitmap.mapping, pool->bitmap.mapping_size);
+            memset(&pool->bitmap, 0, sizeof(pool->bitmap));
+            pool->granule = 0;
+        } else if (pool->blocks.fixed) {
+            memset(&pool->blocks, 0, sizeof(pool->blocks));
+        } else {
+            munmap(pool->blocks.mapping, pool->blocks.mapping_size);
+            memset(&pool->blocks, 0, sizeof(pool->blocks));
+        }
 
-    Block* current = head_block;
-    while (current != NULL) {
-        Block* next = current->next;
-        free(current);
-        current = next;
+        pool->base = NULL;
+        pool->head = BLOCK_NIL;
+        pool->rover = BLOCK_NIL;
+        pool->tree = BLOCK_NIL;
+        pool->size = 0;
+        pool->lifetime = MEM_LONG_LIVED;
+        pool->live_blocks = 0;
     }
+    atomic_store(&pool_count, 0);
 
-    head_block = NULL;
-    memory_pool_size = 0;
+    // Handles die with their blocks
+    if (handle_table) {
+        munmap(handle_table, handle_capacity * sizeof(HandleEntry));
+    }
+    handle_table = NULL;
+    handle_capacity = 0;
+    handle_used = 0;
+    handle_free = 0;
+    epoch_discard_retired();
+    cache_discard_depots();
+    atomic_fetch_add(&mem_pool_generation, 1);
+}
+
+// Returns the start of the memory pool (the first pool after mem_init_numa).
+// Returns:
+// - The address handed out for offset 0 of the pool, or NULL if mem_init has not been called.
+void* mem_pool_base(void) {
+    return pool_count > 0 ? pools[0].base : NULL;
 }
@@ -3,14 +3,124 @@
 
 #include <stddef.h>  // For size_t
 #include <stdbool.h> // For bool
+#include <stdint.h>  // For uint32_t
 
 
 
 // Declare memory management functions
+// mem_alloc, mem_free and mem_resize are thread-safe; mem_init, mem_init_numa, mem_init_bitmap, mem_init_file,
+// mem_init_shared and mem_deinit are not.
 void mem_init(size_t size);
 void* mem_alloc(size_t size);
 void mem_free(void* block);
 void* mem_resize(void* block, size_t size);
 void mem_deinit();
 
+// Zeroed allocation; memory known to be zero (never handed out, or purged) is not cleared again
+void* mem_calloc(size_t count, size_t size);
+
+// Aligned allocation, block size lookup and growth by further mmap'd regions
+void* mem_alloc_aligned(size_t alignment, size_t size);
+size_t mem_usable_size(const void* ptr);
+bool mem_owns(const void* ptr);
+int mem_grow(size_t size);
+
+// Lifetime hints: short-lived requests go to sub-pools of their own (mem_grow_hint), so
+// long-lived blocks allocated in between do not keep those sub-pools fragmented
+typedef enum MemLifetime {
+    MEM_LONG_LIVED,   // No hint: the general pools, as mem_alloc
+    MEM_SHORT_LIVED   // Freed again soon: the short-lived sub-pools first
+} MemLifetime;
+
+void* mem_alloc_hint(size_t size, MemLifetime lifetime);
+int mem_grow_hint(size_t size, MemLifetime lifetime);
+
+// Bitmap pool: allocations are whole granules (a power of two), tracked with two bits per
+// granule instead of a block descriptor each
+void mem_init_bitmap(size_t size, size_t granule);
+
+// Persistent pool: the pool and its bookkeeping live in a file, which a later process
+// maps again with all blocks intact (see mem_init_file). Shared pool: several processes
+// allocate from one POSIX shared memory object at once (see mem_init_shared). Roots are
+// the entry points to the data stored in either; offsets name blocks across processes.
+#define MEM_ROOTS 16
+
+int mem_init_file(const char* path, size_t size);
+int mem_init_shared(const char* name, size_t size);
+void mem_set_root(unsigned index, void* ptr);
+void* mem_root(unsigned index);
+size_t mem_to_offset(const void* ptr);
+void* mem_from_offset(size_t offset);
+
+// Relocatable blocks: compaction (mem_compact, or mem_handle_alloc when memory runs out)
+// may move a handle's block while it is unlocked. Lock a handle to get its address.
+typedef uint32_t MemHandle;
+#define MEM_HANDLE_NULL 0
+
+MemHandle mem_handle_alloc(size_t size);
+void mem_handle_free(MemHandle handle);
+void* mem_handle_lock(MemHandle handle);
+void mem_handle_unlock(MemHandle handle);
+size_t mem_compact(size_t budget);
+
+// Memory pressure: when an allocation finds no room, the handler is called with the
+// requested size and retried (a few times at most) while it returns true.
+// mem_pressure_trim flushes the caches, reclaims retired blocks and compacts.
+typedef bool (*MemPressureHandler)(size_t size, void* arg);
+
+void mem_set_pressure_handler(MemPressureHandler handler, void* arg);
+bool mem_pressure_trim(size_t size, void* arg);
+
+// Placement policy within a pool; first fit unless changed with mem_set_policy
+typedef enum MemPolicy {
+    MEM_FIRST_FIT,
+    MEM_NEXT_FIT,
+    MEM_BEST_FIT,
+    MEM_WORST_FIT
+} MemPolicy;
+
+void mem_set_policy(MemPolicy policy);
+
+// Fragmentation statistics over all pools
+typedef struct MemStats {
+    size_t free_bytes;     // Total size of the free blocks
+    size_t largest_free;   // Size of the largest free block
+    size_t free_blocks;    // Number of free blocks
+    size_t used_bytes;     // Total size of the allocated blocks
+    size_t used_blocks;    // Number of allocated blocks
+} MemStats;
+
+void mem_get_stats(MemStats* stats);
+
+// Batched variants: one walk of the block list for the whole batch
+size_t mem_alloc_many(size_t size, size_t count, void** out);
+void mem_free_many(void** ptrs, size_t count);
+
+// Per-thread magazine caches for small blocks (up to MEM_SIZE_CLASS_MAX bytes, 256 by
+// default): lock-free in the common case. Blocks from mem_cache_alloc must be released
+// with mem_cache_free and the same size. The _class variants take a class index from
+// memory_manager_classes.h, whose inline mem_cache_alloc_sized resolves constant sizes
+// at compile time.
+void* mem_cache_alloc(size_t size);
+void mem_cache_free(void* ptr, size_t size);
+void* mem_cache_alloc_class(unsigned class_index);
+void mem_cache_free_class(void* ptr, unsigned class_index);
+void mem_cache_flush(void);
+
+// Deferred reclamation for lock-free readers: blocks passed to mem_retire are freed once
+// every thread that was inside a mem_epoch_enter/mem_epoch_exit section has left it.
+void mem_epoch_enter(void);
+void mem_epoch_exit(void);
+void mem_retire(void* ptr);
+void mem_reclaim(void);
+
+// NUMA-aware pools: one pool per node (MEM_NUMA_FAKE_NODES=n fakes n nodes). Threads
+// allocate from their own node's pool first; mem_free returns blocks to their pool.
+int mem_init_numa(size_t size_per_node);
+void mem_numa_set_node(int node);
+int mem_numa_node_of(const void* ptr);
+
+// Returns the start of the memory pool (NULL before mem_init)
+void* mem_pool_base(void);
+
 #endif // MEMORY_MANAGER_H
@@ -0,0 +1,85 @@
+#ifndef MEMORY_MANAGER_INLINE_H
+#define MEMORY_MANAGER_INLINE_H
+
+#include <stddef.h>
+#include <stdatomic.h>
+#include "memory_manager.h"
+#include "memory_manager_classes.h"
+
+// Inline fast paths for hot small allocations. Every thread keeps one free list per size
+// class; mem_alloc_inline pops from it and mem_free_inline pushes onto it without
+// calling into the library, which is only entered to refill an empty list or to drain
+// a full one. Linking against libmemory_manager.a (make static) lets LTO inline the
+// refill paths as well.
+//
+// Blocks from mem_alloc_inline are ordinary pool blocks: release them with
+// mem_free_inline and the same size, or with mem_free. Lists are returned to the pool
+// when their thread exits or calls mem_inline_flush.
+
+// Free list of one class; the link to the next block is stored in the block itself.
+typedef struct MemInlineList {
+    void* head;
+    unsigned count;
+} MemInlineList;
+
+typedef struct MemInlineCache {
+    unsigned generation;                         // mem_pool_generation the lists belong to
+    bool registered;                             // Thread exit hook installed
+    MemInlineList lists[MEM_SIZE_CLASSES];
+} MemInlineCache;
+
+extern __thread MemInlineCache mem_inline_cache;
+extern atomic_uint mem_pool_generation;          // Changes with every mem_init and mem_deinit
+
+// Slow paths: refill returns one block and puts more on the list; overflow drains the
+// list and takes ptr.
+void* mem_inline_refill(unsigned class_index);
+void mem_inline_overflow(void* ptr, unsigned class_index);
+void mem_inline_flush(void);
+
+// Lists hold up to this many blocks before half of them go back to the pool.
+#define MEM_INLINE_LIMIT(class_index) (2u * mem_size_class_rounds[class_index])
+
+static inline bool mem_inline_current(void) {
+    return mem_inline_cache.generation == atomic_load_explicit(&mem_pool_generation, memory_order_relaxed);
+}
+
+// Allocates size bytes, from the calling thread's free list when it has a block.
+static inline void* mem_alloc_inline(size_t size) {
+    if (size > MEM_SIZE_CLASS_MAX) {
+        return mem_alloc(size);
+    }
+    unsigned class_index = mem_size_class(size);
+    MemInlineList* list = &mem_inline_cache.lists[class_index];
+    void* block = list->head;
+    if (__builtin_expect(block != NULL && mem_inline_current(), 1)) {
+        list->head = *(void**)block;
+        list->count--;
+        return block;
+    }
+    return mem_inline_refill(class_index);
+}
+
+// Releases a block of size bytes onto the calling thread's free list.
+static inline void mem_free_inline(void* ptr, size_t size) {
+    if (size > MEM_SIZE_CLASS_MAX) {
+        if (ptr) {
+            mem_free(ptr);
+        }
+        return;
+    }
+    if (!ptr) {
+        return;
+    }
+    unsigned class_index = mem_size_class(size);
+    MemInlineList* list = &mem_inline_cache.lists[class_index];
+    if (__builtin_expect(list->count < MEM_INLINE_LIMIT(class_index) && mem_inline_current(), 1)) {
+        *(void**)ptr = list->head;
+        list->head = ptr;
+        list->count++;
+        return;
+    }
+    mem_inline_overflow(ptr, class_index);
+}
+
+#endif // MEMORY_MANAGER_INLINE_H
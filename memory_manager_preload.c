@@ -0,0 +1,168 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <malloc.h>
+#include <unistd.h>
+#include "memory_manager.h"
+
+// malloc, free, realloc, calloc and the aligned variants on top of the memory pool, for
+// running unmodified programs on the allocator:
+//
+//     LD_PRELOAD=./libmemory_manager_preload.so sort big.txt
+//
+// The pool is created by the first allocation and grows by mmap'd regions of doubling
+// size (mem_grow), so nothing here or in the allocator calls back into libc malloc.
+// Pointers that the pool does not own (handed out before the shim was loaded) are
+// ignored by free.
+
+#define SHIM_ALIGNMENT 16                      // Alignment of malloc results
+#define SHIM_FIRST_REGION (64 * 1024 * 1024)   // Size of the first region
+
+static pthread_mutex_t shim_lock = PTHREAD_MUTEX_INITIALIZER;
+static atomic_uint shim_regions = 0;           // Number of regions added so far
+static size_t shim_next_region = SHIM_FIRST_REGION;
+
+// Adds a region that can hold an allocation of size bytes, unless another thread added
+// one since the caller saw regions.
+// Returns:
+// - true if the allocation is worth retrying.
+static bool shim_grow(unsigned regions, size_t size) {
+    pthread_mutex_lock(&shim_lock);
+    bool grown = atomic_load(&shim_regions) != regions;
+    if (!grown) {
+        size_t region = shim_next_region;
+        while (region < size && region <= SIZE_MAX / 2) {
+            region *= 2;
+        }
+        if (region >= size && mem_grow(region) == 0) {
+            shim_next_region = region <= SIZE_MAX / 2 ? region * 2 : region;
+            atomic_fetch_add(&shim_regions, 1);
+            grown = true;
+        }
+    }
+    pthread_mutex_unlock(&shim_lock);
+    return grown;
+}
+
+// Allocates size bytes aligned to alignment (a power of two), growing the pool as needed.
+// Sizes are rounded up to SHIM_ALIGNMENT so that every block, and so every malloc
+// result, stays aligned to it. Zero-sized requests get a block of their own. zero asks
+// for zeroed memory (mem_calloc, SHIM_ALIGNMENT only).
+static void* shim_alloc(size_t alignment, size_t size, bool zero) {
+    if (size > SIZE_MAX - SHIM_ALIGNMENT - alignment) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    size = size ? (size + SHIM_ALIGNMENT - 1) & ~(size_t)(SHIM_ALIGNMENT - 1) : SHIM_ALIGNMENT;
+
+    for (;;) {
+        unsigned regions = atomic_load(&shim_regions);
+        void* ptr;
+        if (zero) {
+            ptr = mem_calloc(1, size);
+        } else {
+            ptr = alignment <= SHIM_ALIGNMENT ? mem_alloc(size) : mem_alloc_aligned(alignment, size);
+        }
+        if (ptr) {
+            return ptr;
+        }
+        if (!shim_grow(regions, size + alignment)) {
+            errno = ENOMEM;
+            return NULL;
+        }
+    }
+}
+
+void* malloc(size_t size) {
+    return shim_alloc(SHIM_ALIGNMENT, size, false);
+}
+
+void free(void* ptr) {
+    if (ptr && mem_owns(ptr)) {
+        mem_free(ptr);
+    }
+}
+
+void* calloc(size_t count, size_t size) {
+    if (size != 0 && count > SIZE_MAX / size) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    return shim_alloc(SHIM_ALIGNMENT, count * size, true);
+}
+
+void* realloc(void* ptr, size_t size) {
+    if (!ptr) {
+        return malloc(size);
+    }
+    if (size == 0) {
+        free(ptr);
+        return NULL;
+    }
+    if (!mem_owns(ptr) || size > SIZE_MAX - SHIM_ALIGNMENT) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    size_t rounded = (size + SHIM_ALIGNMENT - 1) & ~(size_t)(SHIM_ALIGNMENT - 1);
+    void* new_ptr = mem_resize(ptr, rounded);
+    if (new_ptr) {
+        return new_ptr;
+    }
+
+    // The block's region is full: move it to wherever malloc finds room
+    size_t old_size = mem_usable_size(ptr);
+    new_ptr = malloc(size);
+    if (new_ptr) {
+        memcpy(new_ptr, ptr, old_size < size ? old_size : size);
+        mem_free(ptr);
+    }
+    return new_ptr;
+}
+
+int posix_memalign(void** memptr, size_t alignment, size_t size) {
+    if (alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0) {
+        return EINVAL;
+    }
+    void* ptr = shim_alloc(alignment, size, false);
+    if (!ptr) {
+        return ENOMEM;
+    }
+    *memptr = ptr;
+    return 0;
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    return shim_alloc(alignment, size, false);
+}
+
+// Legacy aligned allocators, replaced too so that their blocks are not handed to free
+// from glibc's heap.
+void* memalign(size_t alignment, size_t size) {
+    return aligned_alloc(alignment, size);
+}
+
+void* valloc(size_t size) {
+    return shim_alloc((size_t)sysconf(_SC_PAGESIZE), size, false);
+}
+
+void* pvalloc(size_t size) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    if (size > SIZE_MAX - page) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    return shim_alloc(page, (size + page - 1) & ~(page - 1), false);
+}
+
+size_t malloc_usable_size(void* ptr) {
+    return ptr ? mem_usable_size(ptr) : 0;
+}
@@ -0,0 +1,170 @@
+// perf_counters.h
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+// Hardware performance counters for the benchmarks, read with perf_event_open around a
+// scenario and reported per operation, so a change can be explained and not just timed:
+//
+//     PerfScope perf = perf_begin();
+//     ... the measured loop ...
+//     perf_end(&perf, "mem_alloc/mem_free pair", pairs);
+//
+// Counting is off unless BENCH_PERF is set (make run_bench_perf). The counters
+// cover user space of the calling process and the threads it starts. A counter the
+// machine or the kernel does not provide (no PMU in a VM, kernel.perf_event_paranoid
+// too strict) is left out of the report, and if none can be opened the benchmarks
+// report times only, after saying why once.
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#define PERF_EVENTS 6
+
+typedef struct PerfScope
+{
+    int fds[PERF_EVENTS]; // One counter per event, -1 if it is not counted
+} PerfScope;
+
+static const char *const perf_event_names[PERF_EVENTS] = {
+    "cycles", "instructions", "L1d misses", "LLC misses", "dTLB misses", "branch misses"};
+
+// Returns the perf_event_open configuration of event index (see perf_event_names).
+static inline struct perf_event_attr perf_event_attr_of(int index)
+{
+    static const uint32_t types[PERF_EVENTS] = {
+        PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE,
+        PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE};
+    static const uint64_t configs[PERF_EVENTS] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+        PERF_COUNT_HW_BRANCH_MISSES};
+
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = types[index];
+    attr.config = configs[index];
+    attr.disabled = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    // Scale for multiplexing when the PMU has fewer counters than events
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return attr;
+}
+
+// Opens and starts the counters for a scenario; does nothing unless BENCH_PERF is set.
+static inline PerfScope perf_begin(void)
+{
+    static int explained = 0;
+    PerfScope scope;
+    for (int i = 0; i < PERF_EVENTS; i++)
+    {
+        scope.fds[i] = -1;
+    }
+    const char *enabled = getenv("BENCH_PERF");
+    if (!enabled || atoi(enabled) == 0)
+    {
+        return scope;
+    }
+
+    int opened = 0;
+    int error = 0;
+    for (int i = 0; i < PERF_EVENTS; i++)
+    {
+        struct perf_event_attr attr = perf_event_attr_of(i);
+        scope.fds[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if (scope.fds[i] < 0)
+        {
+            error = errno;
+        }
+        else
+        {
+            opened++;
+        }
+    }
+    if (opened == 0 && !explained)
+    {
+        printf("\t[perf] no hardware counters (%s): check kernel.perf_event_paranoid, or the "
+               "machine may have no PMU; reporting times only\n",
+               strerror(error));
+        explained = 1;
+    }
+    for (int i = 0; i < PERF_EVENTS; i++)
+    {
+        if (scope.fds[i] >= 0)
+        {
+            ioctl(scope.fds[i], PERF_EVENT_IOC_RESET, 0);
+            ioctl(scope.fds[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+    return scope;
+}
+
+// Stops the counters of a scenario and prints them per operation.
+// Parameters:
+// - scope: from perf_begin; its counters are closed.
+// - operation: what one operation of the scenario is, for the report.
+// - operations: the number of operations the scenario performed.
+static inline void perf_end(PerfScope *scope, const char *operation, double operations)
+{
+    for (int i = 0; i < PERF_EVENTS; i++)
+    {
+        if (scope->fds[i] >= 0)
+        {
+            ioctl(scope->fds[i], PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+
+    double per_op[PERF_EVENTS];
+    int counted = 0;
+    for (int i = 0; i < PERF_EVENTS; i++)
+    {
+        uint64_t values[3]; // Count, time enabled, time running
+        per_op[i] = -1;
+        if (scope->fds[i] < 0)
+        {
+            continue;
+        }
+        if (read(scope->fds[i], values, sizeof(values)) == (ssize_t)sizeof(values) && values[2] > 0)
+        {
+            double scaled = (double)values[0] * ((double)values[1] / values[2]);
+            per_op[i] = operations > 0 ? scaled / operations : scaled;
+            counted++;
+        }
+        close(scope->fds[i]);
+        scope->fds[i] = -1;
+    }
+    if (counted == 0)
+    {
+        return;
+    }
+
+    printf("\t[perf] per %s:", operation);
+    const char *separator = " ";
+    for (int i = 0; i < PERF_EVENTS; i++)
+    {
+        if (per_op[i] >= 0)
+        {
+            printf("%s%s %.2f", separator, perf_event_names[i], per_op[i]);
+            separator = ", ";
+        }
+    }
+    if (per_op[0] > 0 && per_op[1] >= 0)
+    {
+        printf(", IPC %.2f", per_op[1] / per_op[0]);
+    }
+    printf("\n");
+}
+
+#endif // PERF_COUNTERS_H
@@ -4,6 +4,10 @@
 #include <assert.h>
 #include <time.h>
 #include <stddef.h>
+#include <pthread.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
 
 #include "common_defs.h"
 #include "gitdata.h"
@@ -472,6 +476,483 @@ void test_list_edge_cases()
     printf_green("[PASS].\n");
 }
 
+void test_list_node_pool()
+{
+    printf_yellow("  Testing node pool locality and reuse ---> ");
+    Node *head = NULL;
+    list_init(&head, sizeof(Node) * 4);
+    list_insert(&head, 10);
+    list_insert(&head, 20);
+    list_insert(&head, 30);
+
+    // Nodes allocated together are adjacent in the pool
+    my_assert(head->next == head + 1);
+    my_assert(head->next->next == head + 2);
+
+    // A deleted node's slot is handed out again
+    Node *middle = head->next;
+    list_delete(&head, 20);
+    list_insert(&head, 40);
+    my_assert(head->next->next == middle);
+    my_assert(middle->data == 40);
+
+    // The fourth slot still fits, the fifth exceeds the pool
+    list_insert(&head, 50);
+    list_insert(&head, 60);
+    my_assert(list_count_nodes(&head) == 4);
+    list_cleanup(&head);
+
+    // Fill the first seven chunks (16 + 32 + ... + 1024 slots) exactly, then release
+    // one slot in the first and one in the last chunk: both are reused before growing
+    list_init(&head, sizeof(Node) * 4 * 1024);
+    list_insert(&head, 0);
+    Node *tail = head;
+    for (int i = 1; i < 2032; i++)
+    {
+        list_insert_after(tail, i);
+        tail = tail->next;
+    }
+    Node *early = list_search(&head, 5);
+    Node *late = list_search(&head, 2000);
+    list_delete(&head, 5);
+    list_delete(&head, 2000);
+    list_insert_after(head, 5000);
+    list_insert_after(head, 5001);
+    my_assert((head->next == early && head->next->next == late) ||
+              (head->next == late && head->next->next == early));
+    my_assert(list_count_nodes(&head) == 2032);
+
+    list_cleanup(&head);
+    printf_green("[PASS].\n");
+}
+
+void test_clist_operations()
+{
+    printf_yellow("  Testing compact list operations ---> ");
+    CNode *head = NULL;
+    clist_init(&head, sizeof(CNode) * 4);
+#ifndef LIST_PACKED_CNODE
+    my_assert(sizeof(CNode) == 8);
+#endif
+    clist_insert(&head, 10);
+    clist_insert(&head, 30);
+    clist_insert_after(head, 20);
+    my_assert(clist_count_nodes(&head) == 3);
+    my_assert(head->data == 10);
+    my_assert(clist_next(head)->data == 20);
+    my_assert(clist_next(clist_next(head))->data == 30);
+    my_assert(clist_next(clist_next(clist_next(head))) == NULL);
+
+    my_assert(clist_search(&head, 30)->data == 30);
+    my_assert(clist_search(&head, 40) == NULL);
+
+    clist_delete(&head, 10);
+    my_assert(head->data == 20);
+    clist_delete(&head, 30);
+    my_assert(clist_next(head) == NULL);
+    my_assert(clist_count_nodes(&head) == 1);
+
+    clist_cleanup(&head);
+    my_assert(head == NULL);
+    printf_green("[PASS].\n");
+}
+
+void test_list_compact()
+{
+    printf_yellow("  Testing list_compact ---> ");
+    Node *head = NULL;
+    list_init(&head, sizeof(Node) * 4 * 1024);
+
+    // Inserting after the head leaves traversal order opposite to address order
+    list_insert(&head, 0);
+    for (int i = 6; i >= 1; i--)
+    {
+        list_insert_after(head, i);
+    }
+
+    my_assert(list_compact(&head) == 0);
+    my_assert(list_count_nodes(&head) == 7);
+    Node *current = head;
+    for (int i = 0; i < 7; i++)
+    {
+        my_assert(current->data == i);
+        my_assert(i == 6 || current->next == current + 1);
+        current = current->next;
+    }
+
+    // The emptied chunk went back to the pool, so the list can grow again
+    list_insert(&head, 7);
+    my_assert(list_count_nodes(&head) == 8);
+
+    // Incremental compaction, two nodes per step
+    ListCompaction state;
+    my_assert(list_compact_begin(&head, &state) == 0);
+    int steps = 1;
+    while (!list_compact_step(&state, 2))
+    {
+        my_assert(list_count_nodes(&head) == 8);
+        steps++;
+    }
+    my_assert(steps == 4);
+    current = head;
+    for (int i = 0; i < 8; i++)
+    {
+        my_assert(current->data == i);
+        my_assert(i == 7 || current->next == current + 1);
+        current = current->next;
+    }
+
+    // A compaction abandoned partway keeps the moved prefix and leaves a valid list
+    for (int i = 12; i >= 8; i--)
+    {
+        list_insert_after(head->next->next, i);
+    }
+    my_assert(list_compact_begin(&head, &state) == 0);
+    my_assert(!list_compact_step(&state, 4));
+    list_compact_abort(&state);
+    list_compact_abort(&state);
+    my_assert(list_count_nodes(&head) == 13);
+    my_assert(head->next == head + 1 && head->next->next->next == head + 3);
+    int expected[] = { 0, 1, 2, 8, 9, 10, 11, 12, 3, 4, 5, 6, 7 };
+    current = head;
+    for (int i = 0; i < 13; i++)
+    {
+        my_assert(current->data == expected[i]);
+        current = current->next;
+    }
+
+    // The list can change again, and the returned tail is available to a new compaction
+    list_insert_after(head, 13);
+    list_delete(&head, 13);
+    my_assert(list_compact_begin(&head, &state) == 0);
+    list_compact_abort(&state);
+    my_assert(list_count_nodes(&head) == 13);
+    my_assert(list_compact(&head) == 0);
+    current = head;
+    for (int i = 0; i < 13; i++)
+    {
+        my_assert(current->data == expected[i]);
+        my_assert(i == 12 || current->next == current + 1);
+        current = current->next;
+    }
+
+    list_cleanup(&head);
+    printf_green("[PASS].\n");
+}
+
+void test_list_to_string()
+{
+    printf_yellow("  Testing list_to_string and list_fprint_range ---> ");
+    Node *head = NULL;
+    list_init(&head, sizeof(Node) * 4);
+    list_insert(&head, 0);
+    list_insert(&head, 65535);
+    list_insert(&head, 7);
+    list_insert(&head, 100);
+
+    char buffer[64];
+    my_assert(list_to_string(&head, buffer, sizeof(buffer)) == 18);
+    my_assert(strcmp(buffer, "[0, 65535, 7, 100]") == 0);
+
+    // Truncated output is terminated and reports the full length
+    my_assert(list_to_string(&head, buffer, 6) == 18);
+    my_assert(strcmp(buffer, "[0, 6") == 0);
+
+    FILE *fp = tmpfile();
+    my_assert(fp != NULL);
+    list_fprint_range(fp, &head, head->next, head->next->next);
+    rewind(fp);
+    memset(buffer, 0, sizeof(buffer));
+    fread(buffer, 1, sizeof(buffer) - 1, fp);
+    fclose(fp);
+    my_assert(strcmp(buffer, "[65535, 7]") == 0);
+
+    list_cleanup(&head);
+    my_assert(list_to_string(&head, buffer, sizeof(buffer)) == 2);
+    my_assert(strcmp(buffer, "[]") == 0);
+    printf_green("[PASS].\n");
+}
+
+void test_list_save_load()
+{
+    printf_yellow("  Testing list_save and list_load ---> ");
+    Node *head = NULL;
+    list_init(&head, sizeof(Node) * 32);
+    list_insert(&head, 10);
+    list_insert(&head, 65535);
+    list_insert(&head, 0);
+
+    FILE *fp = tmpfile();
+    my_assert(fp != NULL);
+    int fd = fileno(fp);
+    my_assert(list_save(&head, fd) == 0);
+    list_cleanup(&head);
+
+    // Zero-copy view of the saved values
+    size_t count = 0;
+    size_t map_size = 0;
+    const uint16_t *values = list_map_values(fd, &count, &map_size);
+    my_assert(values != NULL);
+    my_assert(count == 3);
+    my_assert(values[0] == 10 && values[1] == 65535 && values[2] == 0);
+    list_unmap_values(values, map_size);
+
+    // A file that goes on past its values is unmapped to its end
+    FILE *long_fp = tmpfile();
+    my_assert(long_fp != NULL);
+    int long_fd = fileno(long_fp);
+    long page = sysconf(_SC_PAGESIZE);
+    list_init(&head, sizeof(Node) * 32);
+    list_insert(&head, 5);
+    my_assert(list_save(&head, long_fd) == 0);
+    list_cleanup(&head);
+    my_assert(ftruncate(long_fd, 4 * page) == 0);
+    values = list_map_values(long_fd, &count, &map_size);
+    my_assert(values != NULL && count == 1 && values[0] == 5 && map_size == (size_t)(4 * page));
+    char *last_page = (char *)((uintptr_t)values & ~(uintptr_t)(page - 1)) + 3 * page;
+    my_assert(msync(last_page, page, MS_ASYNC) == 0);
+    list_unmap_values(values, map_size);
+    my_assert(msync(last_page, page, MS_ASYNC) == -1 && errno == ENOMEM);
+    fclose(long_fp);
+
+    // Loading appends to the existing list
+    list_init(&head, sizeof(Node) * 32);
+    list_insert(&head, 7);
+    my_assert(list_load(&head, fd) == 3);
+    char buffer[64];
+    list_to_string(&head, buffer, sizeof(buffer));
+    my_assert(strcmp(buffer, "[7, 10, 65535, 0]") == 0);
+    my_assert(head->next->next == head->next + 1);
+
+    list_cleanup(&head);
+    fclose(fp);
+    printf_green("[PASS].\n");
+}
+
+void test_list_insert_sorted()
+{
+    printf_yellow("  Testing list_insert_sorted ---> ");
+    Node *head = NULL;
+    list_init(&head, sizeof(Node) * 5);
+    list_insert_sorted(&head, 30);
+    list_insert_sorted(&head, 10);
+    list_insert_sorted(&head, 40);
+    list_insert_sorted(&head, 20);
+    list_insert_sorted(&head, 20);
+
+    char buffer[64];
+    list_to_string(&head, buffer, sizeof(buffer));
+    my_assert(strcmp(buffer, "[10, 20, 20, 30, 40]") == 0);
+
+    list_cleanup(&head);
+    printf_green("[PASS].\n");
+}
+
+void test_skiplist(int count)
+{
+    printf_yellow("  Testing skip list operations ---> ");
+    SkipList list;
+    skiplist_init(&list, (sizeof(Node) + sizeof(SkipIndex)) * count * 2);
+
+    int histogram[256] = {0};
+    for (int i = 0; i < count; i++)
+    {
+        int value = rand() % 256;
+        skiplist_insert(&list, value);
+        histogram[value]++;
+    }
+    my_assert(list_count_nodes(&list.head) == count);
+
+    // The base list is sorted
+    for (Node *current = list.head; current->next != NULL; current = current->next)
+    {
+        my_assert(current->data <= current->next->data);
+    }
+
+    for (int value = 0; value < 256; value++)
+    {
+        Node *found = skiplist_search(&list, value);
+        my_assert(histogram[value] ? found != NULL && found->data == value : found == NULL);
+        Node *bound = skiplist_lower_bound(&list, value);
+        my_assert(bound == found || (found == NULL && (bound == NULL || bound->data > value)));
+    }
+
+    // Delete every occurrence of the even values
+    for (int value = 0; value < 256; value += 2)
+    {
+        while (histogram[value] > 0)
+        {
+            skiplist_delete(&list, value);
+            histogram[value]--;
+        }
+        my_assert(skiplist_search(&list, value) == NULL);
+    }
+    for (int value = 1; value < 256; value += 2)
+    {
+        my_assert((skiplist_search(&list, value) != NULL) == (histogram[value] > 0));
+    }
+
+    // Range display by value bounds
+    skiplist_insert(&list, 1000);
+    skiplist_insert(&list, 1002);
+    skiplist_insert(&list, 1001);
+    skiplist_insert(&list, 2000);
+    char buffer[64] = {0};
+    FILE *original_stdout = stdout;
+    FILE *fp = tmpfile();
+    my_assert(fp != NULL);
+    stdout = fp;
+    skiplist_display_range(&list, 999, 1500);
+    stdout = original_stdout;
+    rewind(fp);
+    fread(buffer, 1, sizeof(buffer) - 1, fp);
+    fclose(fp);
+    my_assert(strcmp(buffer, "[1000, 1001, 1002]") == 0);
+
+    skiplist_cleanup(&list);
+    my_assert(list.head == NULL);
+    printf_green("[PASS].\n");
+}
+
+void test_list_parallel(int count)
+{
+    printf_yellow("  Testing parallel reduce and find-all ---> ");
+    Node *head = NULL;
+    list_init(&head, sizeof(Node) * count);
+    list_insert(&head, rand() % 100);
+    Node *tail = head;
+    for (int i = 1; i < count; i++)
+    {
+        list_insert_after(tail, rand() % 100);
+        tail = tail->next;
+    }
+
+    // Sequential reference
+    uint64_t sum = 0;
+    int min = 100, max = -1, hits = 0;
+    for (Node *current = head; current != NULL; current = current->next)
+    {
+        sum += current->data;
+        min = current->data < min ? current->data : min;
+        max = current->data > max ? current->data : max;
+        hits += current->data == 42;
+    }
+
+    ListSample sample;
+    my_assert(list_sample(&head, 97, &sample) == 0);
+    my_assert(sample.count == (size_t)count);
+    my_assert(sample.segments == (size_t)(count + 96) / 97);
+
+    Node **matches = malloc(sizeof(Node *) * count);
+    for (int threads = 1; threads <= 4; threads *= 2)
+    {
+        ListStats stats = list_parallel_reduce(&sample, threads);
+        my_assert(stats.count == (size_t)count);
+        my_assert(stats.sum == sum);
+        my_assert(stats.min == min && stats.max == max);
+
+        my_assert(list_parallel_find_all(&sample, threads, 42, matches, count) == (size_t)hits);
+        int k = 0;
+        for (Node *current = head; current != NULL; current = current->next)
+        {
+            if (current->data == 42)
+            {
+                my_assert(matches[k++] == current);
+            }
+        }
+        // A short output array keeps the first matches and still reports the total
+        my_assert(list_parallel_find_all(&sample, threads, 42, matches, 1) == (size_t)hits);
+    }
+    free(matches);
+    list_sample_free(&sample);
+
+    // An empty list reduces to the identity
+    list_cleanup(&head);
+    my_assert(list_sample(&head, 16, &sample) == 0);
+    ListStats empty = list_parallel_reduce(&sample, 4);
+    my_assert(empty.count == 0 && empty.min == UINT16_MAX && empty.max == 0);
+    list_sample_free(&sample);
+    printf_green("[PASS].\n");
+}
+
+// Arguments of one stress thread for test_concurrent_list.
+typedef struct StressArgs
+{
+    ConcurrentList *list;
+    int id;
+    int operations;
+    int live; // Values inserted minus values deleted by this thread
+} StressArgs;
+
+// Inserts, deletes and searches values owned by this thread, interleaved with the
+// other threads' values in the shared sorted list.
+static void *concurrent_list_stress(void *arg)
+{
+    StressArgs *args = (StressArgs *)arg;
+    unsigned seed = (unsigned)args->id;
+    int inserted[64] = {0};
+    for (int i = 0; i < args->operations; i++)
+    {
+        int slot = rand_r(&seed) % 64;
+        uint16_t value = (uint16_t)(slot * 8 + args->id); // Values of different threads never collide
+        switch (rand_r(&seed) % 3)
+        {
+        case 0:
+            if (concurrent_list_insert(args->list, value))
+            {
+                inserted[slot]++;
+            }
+            break;
+        case 1:
+            my_assert(concurrent_list_delete(args->list, value) == (inserted[slot] > 0));
+            if (inserted[slot] > 0)
+            {
+                inserted[slot]--;
+            }
+            break;
+        default:
+            my_assert(concurrent_list_contains(args->list, value) == (inserted[slot] > 0));
+            break;
+        }
+    }
+    args->live = 0;
+    for (int slot = 0; slot < 64; slot++)
+    {
+        args->live += inserted[slot];
+    }
+    return NULL;
+}
+
+void test_concurrent_list(int threads, int operations)
+{
+    printf_yellow("  Testing concurrent list with %d threads ---> ", threads);
+    ConcurrentList list;
+    concurrent_list_init(&list, sizeof(LockedNode) * operations * threads);
+
+    pthread_t workers[8];
+    StressArgs args[8];
+    for (int t = 0; t < threads; t++)
+    {
+        args[t] = (StressArgs){&list, t, operations, 0};
+        my_assert(pthread_create(&workers[t], NULL, concurrent_list_stress, &args[t]) == 0);
+    }
+    int live = 0;
+    for (int t = 0; t < threads; t++)
+    {
+        pthread_join(workers[t], NULL);
+        live += args[t].live;
+    }
+
+    my_assert(concurrent_list_count_nodes(&list) == live);
+    for (LockedNode *current = list.head.next; current != NULL && current->next != NULL; current = current->next)
+    {
+        my_assert(current->data <= current->next->data);
+    }
+
+    concurrent_list_cleanup(&list);
+    printf_green("[PASS].\n");
+}
+
 // Main function to run all tests
 int main(int argc, char *argv[])
 {
@@ -502,6 +983,15 @@ int main(int argc, char *argv[])
         printf(" 12. test_list_delete_loop - Test multiple detelions\n");
         printf(" 13. test_list_search_loop - Test multiple search\n");
         printf(" 14. test_list_edge_cases - Test edge cases\n");
+        printf(" 15. test_list_node_pool - Test node adjacency and slot reuse in the node pool\n");
+        printf(" 16. test_clist_operations - Test the compact (32-bit link) list mode\n");
+        printf(" 17. test_list_compact - Test relocating nodes into traversal order\n");
+        printf(" 18. test_list_to_string - Test buffered serialization of the list\n");
+        printf(" 19. test_list_save_load - Test binary save and mmap-based load\n");
+        printf(" 20. test_list_insert_sorted - Test sorted insertion\n");
+        printf(" 21. test_skiplist - Test the skip-list accelerated sorted list\n");
+        printf(" 22. test_list_parallel - Test parallel reduce and find-all over list segments\n");
+        printf(" 23. test_concurrent_list - Stress the concurrent list from several threads\n");
         printf(" 0. Run all tests\n");
         return 1;
     }
@@ -529,6 +1019,15 @@ int main(int argc, char *argv[])
         test_list_delete_loop(1000);
         test_list_search_loop(1000);
         test_list_edge_cases();
+        test_list_node_pool();
+        test_clist_operations();
+        test_list_compact();
+        test_list_to_string();
+        test_list_save_load();
+        test_list_insert_sorted();
+        test_skiplist(1000);
+        test_list_parallel(10000);
+        test_concurrent_list(4, 20000);
         break;
     case 1:
         test_list_init();
@@ -573,6 +1072,33 @@ int main(int argc, char *argv[])
     case 14:
         test_list_edge_cases();
         break;
+    case 15:
+        test_list_node_pool();
+        break;
+    case 16:
+        test_clist_operations();
+        break;
+    case 17:
+        test_list_compact();
+        break;
+    case 18:
+        test_list_to_string();
+        break;
+    case 19:
+        test_list_save_load();
+        break;
+    case 20:
+        test_list_insert_sorted();
+        break;
+    case 21:
+        test_skiplist(1000);
+        break;
+    case 22:
+        test_list_parallel(10000);
+        break;
+    case 23:
+        test_concurrent_list(4, 20000);
+        break;
 
     default:
         printf("Invalid test function\n");
@@ -1,9 +1,18 @@
 #include "memory_manager.h"
+#include "memory_manager_classes.h"
+#include "memory_manager_inline.h"
 #include <stdio.h>
 #include <assert.h>
 #include <string.h>
 #include <stdlib.h>
 #include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
 #include "common_defs.h"
 
 #include "gitdata.h"
@@ -326,6 +335,1203 @@ void test_edge_case_allocations()
     printf_green("[PASS].\n");
 }
 
+void test_alloc_many_and_free_many()
+{
+    printf_yellow("  Testing mem_alloc_many and mem_free_many ---> ");
+    mem_init(1024);
+
+    // The batch is carved from one free block, so the blocks are adjacent
+    void *blocks[8];
+    my_assert(mem_alloc_many(100, 8, blocks) == 8);
+    for (int i = 1; i < 8; i++)
+    {
+        my_assert((char *)blocks[i] == (char *)blocks[0] + i * 100);
+    }
+    my_assert(mem_alloc_many(100, 3, blocks) == 2); // Only 224 bytes are left
+    my_assert(mem_alloc_many(100, 1, blocks) == 0);
+    mem_deinit();
+
+    // Freeing in any order coalesces everything back into one block
+    mem_init(1024);
+    void *all[10];
+    my_assert(mem_alloc_many(100, 10, all) == 10);
+    void *shuffled[10] = {all[7], all[2], all[9], all[0], all[5], all[1], all[8], all[3], all[6], all[4]};
+    mem_free_many(shuffled, 10);
+    void *whole = mem_alloc(1024);
+    my_assert(whole == all[0]);
+    mem_free(whole);
+
+    // Without a single large enough block the batch falls back to separate blocks
+    void *a = mem_alloc(300);
+    void *b = mem_alloc(300);
+    void *c = mem_alloc(300);
+    mem_free(a);
+    mem_free(c);
+    void *pair[2];
+    my_assert(mem_alloc_many(300, 2, pair) == 2);
+    my_assert(pair[0] == a && pair[1] == c);
+
+    mem_free(b);
+    mem_deinit();
+
+    // A freed block merges with a free predecessor; a repeated pointer is only
+    // reported ("already freed") and does not free anything twice
+    mem_init(1024);
+    void *x[4];
+    my_assert(mem_alloc_many(200, 4, x) == 4);
+    mem_free(x[0]);
+    void *batch[3] = {x[3], x[1], x[1]};
+    mem_free_many(batch, 3);
+    void *front = mem_alloc(400);
+    my_assert(front == x[0]);
+    my_assert(mem_alloc(400) == x[3]);
+    mem_free(x[3]);
+    mem_free(x[2]);
+    mem_free(front);
+    whole = mem_alloc(1024);
+    my_assert(whole == x[0]);
+    mem_free(whole);
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
+
+void test_retire_and_reclaim()
+{
+    printf_yellow("  Testing mem_retire and mem_reclaim ---> ");
+    mem_init(1024);
+
+    void *block = mem_alloc(1024);
+    my_assert(block != NULL);
+
+    // A critical section keeps the retired block alive
+    mem_epoch_enter();
+    mem_retire(block);
+    mem_reclaim();
+    my_assert(mem_alloc(1) == NULL);
+    mem_epoch_exit();
+
+    // Once nobody is reading, reclamation frees it
+    mem_reclaim();
+    void *again = mem_alloc(1024);
+    my_assert(again == block);
+    mem_free(again);
+
+    // Retired blocks are freed in batches without an explicit mem_reclaim
+    void *blocks[256];
+    for (int i = 0; i < 256; i++)
+    {
+        blocks[i] = mem_alloc(4);
+        my_assert(blocks[i] != NULL);
+    }
+    for (int i = 0; i < 256; i++)
+    {
+        mem_retire(blocks[i]);
+    }
+    my_assert(mem_alloc(4) != NULL);
+    mem_deinit();
+
+    // A critical section lets the retired list grow past its first page; one reclaim
+    // then frees the whole backlog
+    mem_init(16 * 1024);
+    void *many[1000];
+    for (int i = 0; i < 1000; i++)
+    {
+        many[i] = mem_alloc(16);
+        my_assert(many[i] != NULL);
+    }
+    mem_epoch_enter();
+    for (int i = 0; i < 1000; i++)
+    {
+        mem_retire(many[i]);
+    }
+    mem_reclaim();
+    my_assert(mem_alloc(16 * 1024 - 1000 * 16 + 1) == NULL);
+    mem_epoch_exit();
+    mem_reclaim();
+    void *whole = mem_alloc(16 * 1024);
+    my_assert(whole == many[0]);
+    mem_free(whole);
+
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
+
+void test_cache_alloc_and_free()
+{
+    printf_yellow("  Testing mem_cache_alloc and mem_cache_free ---> ");
+    mem_init(64 * 1024);
+
+    // Blocks of a class are distinct and do not overlap
+    unsigned char *blocks[100];
+    for (int i = 0; i < 100; i++)
+    {
+        blocks[i] = mem_cache_alloc(48);
+        my_assert(blocks[i] != NULL);
+        memset(blocks[i], i, 48);
+    }
+    for (int i = 0; i < 100; i++)
+    {
+        for (int k = 0; k < 48; k++)
+        {
+            my_assert(blocks[i][k] == i);
+        }
+    }
+
+    // The most recently freed block is handed out first
+    mem_cache_free(blocks[42], 48);
+    my_assert(mem_cache_alloc(40) == blocks[42]);
+
+    for (int i = 0; i < 100; i++)
+    {
+        mem_cache_free(blocks[i], 48);
+    }
+
+    // Sizes above the cached range go straight to the pool
+    void *large = mem_cache_alloc(1000);
+    my_assert(large != NULL);
+    mem_cache_free(large, 1000);
+
+    // Flushing gives every cached block back, so the whole pool is free again
+    mem_cache_flush();
+    void *whole = mem_alloc(64 * 1024);
+    my_assert(whole != NULL);
+    mem_free(whole);
+
+    mem_deinit();
+
+    // Magazines filled from a previous pool are never handed out again
+    mem_init(1024);
+    void *fresh = mem_cache_alloc(16);
+    my_assert(fresh != NULL);
+    my_assert((char *)fresh >= (char *)mem_pool_base() && (char *)fresh < (char *)mem_pool_base() + 1024);
+    mem_cache_free(fresh, 16);
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
+
+static void *cache_stress(void *arg)
+{
+    unsigned seed = (unsigned)(size_t)arg;
+    void *held[64] = {0};
+    size_t sizes[64] = {0};
+    for (int i = 0; i < 20000; i++)
+    {
+        int slot = rand_r(&seed) % 64;
+        if (held[slot])
+        {
+            my_assert(*(unsigned char *)held[slot] == (unsigned char)slot);
+            mem_cache_free(held[slot], sizes[slot]);
+            held[slot] = NULL;
+        }
+        else
+        {
+            sizes[slot] = 1 + rand_r(&seed) % 256;
+            held[slot] = mem_cache_alloc(sizes[slot]);
+            my_assert(held[slot] != NULL);
+            memset(held[slot], slot, sizes[slot]);
+        }
+    }
+    for (int slot = 0; slot < 64; slot++)
+    {
+        mem_cache_free(held[slot], sizes[slot]);
+    }
+    return NULL;
+}
+
+void test_cache_threads()
+{
+    printf_yellow("  Testing magazine caches from several threads ---> ");
+    mem_init(4 * 1024 * 1024);
+    pthread_t workers[4];
+    for (int t = 0; t < 4; t++)
+    {
+        my_assert(pthread_create(&workers[t], NULL, cache_stress, (void *)(size_t)(t + 1)) == 0);
+    }
+    for (int t = 0; t < 4; t++)
+    {
+        pthread_join(workers[t], NULL);
+    }
+    mem_cache_flush();
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
+
+// Shared state of test_retire_with_reader.
+typedef struct ReaderState
+{
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int stage; // 1 once the reader is inside its critical section, 2 when it may leave
+} ReaderState;
+
+static void *epoch_reader(void *arg)
+{
+    ReaderState *state = (ReaderState *)arg;
+    mem_epoch_enter();
+    pthread_mutex_lock(&state->lock);
+    state->stage = 1;
+    pthread_cond_broadcast(&state->cond);
+    while (state->stage != 2)
+    {
+        pthread_cond_wait(&state->cond, &state->lock);
+    }
+    pthread_mutex_unlock(&state->lock);
+    mem_epoch_exit();
+    return NULL;
+}
+
+void test_retire_with_reader()
+{
+    printf_yellow("  Testing mem_retire with a concurrent reader ---> ");
+    mem_init(1024);
+    void *block = mem_alloc(1024);
+
+    ReaderState state = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0};
+    pthread_t reader;
+    my_assert(pthread_create(&reader, NULL, epoch_reader, &state) == 0);
+    pthread_mutex_lock(&state.lock);
+    while (state.stage != 1)
+    {
+        pthread_cond_wait(&state.cond, &state.lock);
+    }
+    pthread_mutex_unlock(&state.lock);
+
+    // The reader entered before the block was retired, so it must survive
+    mem_retire(block);
+    mem_reclaim();
+    my_assert(mem_alloc(1) == NULL);
+
+    pthread_mutex_lock(&state.lock);
+    state.stage = 2;
+    pthread_cond_broadcast(&state.cond);
+    pthread_mutex_unlock(&state.lock);
+    pthread_join(reader, NULL);
+
+    mem_reclaim();
+    my_assert(mem_alloc(1024) == block);
+
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
+
+void test_numa_pools()
+{
+    printf_yellow("  Testing NUMA pools on the machine's topology ---> ");
+    int nodes = mem_init_numa(64 * 1024);
+    my_assert(nodes >= 1);
+
+    // Without an override the block comes from the node the thread runs on
+    void *block = mem_alloc(128);
+    my_assert(block != NULL);
+    my_assert(mem_numa_node_of(block) >= 0);
+    memset(block, 0xAB, 128);
+    mem_free(block);
+    my_assert(mem_alloc(128) == block);
+    mem_free(block);
+
+    mem_deinit();
+    my_assert(mem_numa_node_of(block) == -1);
+    printf_green("[PASS].\n");
+}
+
+void test_numa_fake_nodes()
+{
+    printf_yellow("  Testing NUMA pools on a fake two-node topology ---> ");
+    setenv("MEM_NUMA_FAKE_NODES", "2", 1);
+    my_assert(mem_init_numa(1024) == 2);
+    unsetenv("MEM_NUMA_FAKE_NODES");
+
+    mem_numa_set_node(1);
+    void *remote = mem_alloc(512);
+    my_assert(mem_numa_node_of(remote) == 1);
+
+    mem_numa_set_node(0);
+    void *local = mem_alloc(1024);
+    my_assert(mem_numa_node_of(local) == 0);
+
+    // Node 0 is full, so the next allocation spills over to node 1
+    void *spill = mem_alloc(256);
+    my_assert(mem_numa_node_of(spill) == 1);
+
+    // Blocks go back to the pool they came from, also when freed in one batch
+    void *blocks[3] = {spill, local, remote};
+    mem_free_many(blocks, 3);
+    my_assert(mem_alloc(1024) == local);
+    mem_numa_set_node(1);
+    my_assert(mem_alloc(1024) == remote);
+    my_assert(mem_alloc(1) == NULL);
+
+    mem_numa_set_node(-1);
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
+
+void test_grow_and_aligned()
+{
+    printf_yellow("  Testing mem_grow, mem_alloc_aligned and mem_usable_size ---> ");
+    // mem_grow creates the first region when there is none
+    my_assert(mem_alloc(16) == NULL);
+    my_assert(mem_grow(4096) == 0);
+
+    void *small = mem_alloc(100);
+    my_assert(small != NULL && mem_owns(small));
+    my_assert(mem_usable_size(small) == 100);
+    my_assert(!mem_owns(&small));
+
+    void *aligned = mem_alloc_aligned(1024, 200);
+    my_assert(aligned != NULL && ((size_t)aligned % 1024) == 0);
+    my_assert(mem_usable_size(aligned) == 200);
+    my_assert(mem_alloc_aligned(24, 8) == NULL);
+
+    // The first region is too small for this; a second one takes it
+    my_assert(mem_alloc(8192) == NULL);
+    my_assert(mem_grow(16384) == 0);
+    void *large = mem_alloc(8192);
+    my_assert(large != NULL && mem_owns(large));
+
+    mem_free(aligned);
+    my_assert(mem_usable_size(aligned) == 0);
+    mem_free(small);
+    mem_free(large);
+    mem_deinit();
+    my_assert(!mem_owns(large));
+    printf_green("[PASS].\n");
+}
+
+// Returns true if all size bytes at ptr are zero.
+static int all_value(const unsigned char *ptr, unsigned char value, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        if (ptr[i] != value)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int all_zero(const unsigned char *ptr, size_t size)
+{
+    return all_value(ptr, 0, size);
+}
+
+void test_calloc()
+{
+    printf_yellow("  Testing mem_calloc ---> ");
+    mem_init(4096);
+    my_assert(mem_calloc((size_t)-1 / 2, 4) == NULL);
+
+    // Fresh pool memory, then memory that was dirtied and freed
+    unsigned char *fresh = mem_calloc(16, 32);
+    my_assert(fresh != NULL && all_zero(fresh, 512));
+    memset(fresh, 0xFF, 512);
+    mem_free(fresh);
+    unsigned char *reused = mem_calloc(64, 16);
+    my_assert(reused == fresh && all_zero(reused, 1024));
+    mem_free(reused);
+    mem_deinit();
+
+    // A large free block in a mapped region is purged and still reads back as zero
+    my_assert(mem_grow(1024 * 1024) == 0);
+    unsigned char *large = mem_alloc(512 * 1024 + 100);
+    memset(large, 0xAB, 512 * 1024 + 100);
+    mem_free(large);
+    large = mem_calloc(1, 512 * 1024 + 200);
+    my_assert(large != NULL && all_zero(large, 512 * 1024 + 200));
+    mem_free(large);
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
+
+// Sets up a 1000-byte pool with free holes of 300 bytes at offset 0, 100 bytes at 350,
+// 200 bytes at 480 and 310 bytes at the end (690), and returns the pool start.
+static char *make_holes()
+{
+    mem_init(1000);
+    void *a = mem_alloc(300);
+    mem_alloc(50);
+    void *c = mem_alloc(100);
+    mem_alloc(30);
+    void *e = mem_alloc(200);
+    mem_alloc(10);
+    mem_free(a);
+    mem_free(c);
+    mem_free(e);
+    return (char *)a;
+}
+
+void test_placement_policies()
+{
+    printf_yellow("  Testing first, next, best and worst fit placement ---> ");
+    char *base = make_holes();
+    my_assert(mem_alloc(90) == base);
+    mem_deinit();
+
+    mem_set_policy(MEM_BEST_FIT);
+    base = make_holes();
+    my_assert(mem_alloc(90) == base + 350);
+    my_assert(mem_alloc(150) == base + 480);
+    my_assert(mem_alloc(305) == base + 690);
+    my_assert(mem_alloc(301) == NULL);
+    mem_deinit();
+
+    mem_set_policy(MEM_WORST_FIT);
+    base = make_holes();
+    my_assert(mem_alloc(90) == base + 690);
+    my_assert(mem_alloc(90) == base);
+    mem_deinit();
+
+    // Next fit carries on after the previous allocation and wraps around at the end
+    mem_set_policy(MEM_NEXT_FIT);
+    base = make_holes();
+    my_assert(mem_alloc(90) == base + 690);
+    my_assert(mem_alloc(200) == base + 780);
+    my_assert(mem_alloc(200) == base);
+    my_assert(mem_alloc(90) == base + 200);
+    mem_deinit();
+
+    // Random work keeps the free block tree consistent: once everything is freed the
+    // whole pool is one block again
+    mem_set_policy(MEM_BEST_FIT);
+    mem_init(64 * 1024);
+    void *blocks[256] = {NULL};
+    srand(42);
+    for (int i = 0; i < 5000; i++)
+    {
+        int slot = rand() % 256;
+        if (blocks[slot])
+        {
+            mem_free(blocks[slot]);
+            blocks[slot] = NULL;
+        }
+        else
+        {
+            blocks[slot] = mem_alloc(1 + rand() % 512);
+        }
+        if (i == 2500)
+        {
+            mem_set_policy(MEM_WORST_FIT);
+        }
+    }
+    size_t live = 0;
+    for (int i = 0; i < 256; i++)
+    {
+        if (blocks[i])
+        {
+            blocks[live++] = blocks[i];
+        }
+    }
+    mem_free_many(blocks, live);
+    MemStats stats;
+    mem_get_stats(&stats);
+    my_assert(stats.free_blocks == 1 && stats.largest_free == 64 * 1024 && stats.used_blocks == 0);
+    my_assert(mem_alloc(64 * 1024) != NULL);
+    mem_deinit();
+
+    mem_set_policy(MEM_FIRST_FIT);
+    printf_green("[PASS].\n");
+}
+
+void test_block_table()
+{
+    printf_yellow("  Testing block descriptor table growth and recycling ---> ");
+    // One-byte blocks need far more descriptors than the table reserves for the pool
+    mem_init(4096);
+    static char *blocks[4096];
+    for (int round = 0; round < 2; round++)
+    {
+        for (int i = 0; i < 4096; i++)
+        {
+            blocks[i] = mem_alloc(1);
+            my_assert(blocks[i] == (char *)mem_pool_base() + i);
+        }
+        my_assert(mem_alloc(1) == NULL);
+        for (int i = 0; i < 4096; i += 2)
+        {
+            mem_free(blocks[i]);
+        }
+        MemStats stats;
+        mem_get_stats(&stats);
+        my_assert(stats.free_blocks == 2048 && stats.used_blocks == 2048 && stats.largest_free == 1);
+        // mem_free only merges forward; the batched free coalesces the whole pool
+        for (int i = 1; i < 4096; i += 2)
+        {
+            blocks[i / 2] = blocks[i];
+        }
+        mem_free_many((void **)blocks, 2048);
+        mem_get_stats(&stats);
+        my_assert(stats.free_blocks == 1 && stats.largest_free == 4096 && stats.used_blocks == 0);
+    }
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
+
+void test_bitmap_pool()
+{
+    printf_yellow("  Testing bitmap pools ---> ");
+    // 1000 granules of 64 bytes: the bitmaps span several words
+    mem_init_bitmap(64 * 1000, 64);
+    char *base = mem_pool_base();
+    char *a = mem_alloc(1);
+    char *b = mem_alloc(65);
+    char *c = mem_alloc(64);
+    my_assert(a == base && b == base + 64 && c == base + 192);
+    my_assert(mem_usable_size(b) == 128 && mem_usable_size(b + 64) == 0);
+
+    // Freed granules are reused, a block grows in place into free granules after it
+    mem_free(b);
+    my_assert(mem_alloc(100) == b);
+    mem_free(c);
+    mem_free(c);
+    mem_free(b + 64);
+    my_assert(mem_resize(b, 192) == b && mem_usable_size(b) == 192);
+    my_assert(mem_resize(a, 100) == base + 256 && mem_usable_size(base + 256) == 128);
+
+    // Aligned blocks, and runs of blocks carved from one free run
+    char *aligned = mem_alloc_aligned(4096, 10);
+    my_assert(aligned != NULL && (size_t)aligned % 4096 == 0);
+    void *run[10];
+    my_assert(mem_alloc_many(64, 10, run) == 10);
+    for (int i = 1; i < 10; i++)
+    {
+        my_assert((char *)run[i] == (char *)run[0] + 64 * i);
+    }
+
+    MemStats stats;
+    mem_get_stats(&stats);
+    my_assert(stats.used_blocks == 13 && stats.used_bytes == 64 * (3 + 2 + 1 + 10));
+    my_assert(stats.free_bytes + stats.used_bytes == 64 * 1000);
+    mem_free_many(run, 10);
+    mem_free(aligned);
+    mem_free(b);
+    mem_free(base + 256);
+    mem_get_stats(&stats);
+    my_assert(stats.free_blocks == 1 && stats.largest_free == 64 * 1000 && stats.used_blocks == 0);
+
+    // Random blocks never overlap: each keeps its fill pattern until freed
+    my_assert(mem_alloc(64 * 1000) == base && mem_alloc(1) == NULL);
+    mem_free(base);
+    unsigned char *blocks[200] = {NULL};
+    size_t sizes[200];
+    for (int i = 0; i < 20000; i++)
+    {
+        int slot = rand() % 200;
+        if (blocks[slot])
+        {
+            for (size_t j = 0; j < sizes[slot]; j++)
+            {
+                my_assert(blocks[slot][j] == (unsigned char)slot);
+            }
+            mem_free(blocks[slot]);
+            blocks[slot] = NULL;
+        }
+        else
+        {
+            sizes[slot] = 1 + rand() % 600;
+            if ((blocks[slot] = mem_alloc(sizes[slot])) != NULL)
+            {
+                memset(blocks[slot], slot, sizes[slot]);
+            }
+        }
+    }
+    for (int i = 0; i < 200; i++)
+    {
+        if (blocks[i])
+        {
+            mem_free(blocks[i]);
+        }
+    }
+    mem_get_stats(&stats);
+    my_assert(stats.free_blocks == 1 && stats.largest_free == 64 * 1000);
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
+
+void test_size_classes()
+{
+    printf_yellow("  Testing the generated size class tables ---> ");
+    // Every size maps to the smallest class that holds it
+    for (size_t size = 0; size <= MEM_SIZE_CLASS_MAX; size++)
+    {
+        unsigned class_index = mem_size_class(size);
+        my_assert(class_index < MEM_SIZE_CLASSES && mem_size_class_bytes[class_index] >= size);
+        my_assert(class_index == 0 || mem_size_class_bytes[class_index - 1] < size);
+        my_assert(mem_size_class_rounds[class_index] <= MEM_SIZE_CLASS_MAX_ROUNDS);
+    }
+
+    mem_init(64 * 1024);
+    // A class refill takes one magazine of blocks from the pool in one run
+    void *first = mem_cache_alloc_class(MEM_SIZE_CLASS_64);
+    my_assert(first != NULL && mem_usable_size(first) == 64);
+    void *second = mem_cache_alloc_sized(50);
+    my_assert(second != NULL && mem_usable_size(second) == 64 && second != first);
+    mem_cache_free_sized(second, 50);
+    my_assert(mem_cache_alloc(64) == second);
+    mem_cache_free(second, 64);
+    mem_cache_free_class(first, MEM_SIZE_CLASS_64);
+
+    // Sizes above the largest class bypass the caches
+    void *large = mem_cache_alloc_sized(MEM_SIZE_CLASS_MAX + 1);
+    my_assert(large != NULL && mem_usable_size(large) == MEM_SIZE_CLASS_MAX + 1);
+    mem_cache_free_sized(large, MEM_SIZE_CLASS_MAX + 1);
+    mem_cache_flush();
+
+    MemStats stats;
+    mem_get_stats(&stats);
+    my_assert(stats.used_blocks == 0);
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
+
+static void *inline_worker(void *arg)
+{
+    (void)arg;
+    void *blocks[300];
+    for (int round = 0; round < 50; round++)
+    {
+        for (int i = 0; i < 300; i++)
+        {
+            blocks[i] = mem_alloc_inline(16 + i % 200);
+            my_assert(blocks[i] != NULL);
+            *(int *)blocks[i] = i;
+        }
+        for (int i = 0; i < 300; i++)
+        {
+            my_assert(*(int *)blocks[i] == i);
+            mem_free_inline(blocks[i], 16 + i % 200);
+        }
+    }
+    return NULL;
+}
+
+void test_inline_fast_path()
+{
+    printf_yellow("  Testing the inline fast path ---> ");
+    mem_init(1024 * 1024);
+    // The first allocation refills the list with one batch; the rest come from the list
+    void *first = mem_alloc_inline(24);
+    void *second = mem_alloc_inline(32);
+    my_assert(first != NULL && mem_usable_size(first) == 32 && (char *)second == (char *)first + 32);
+    mem_free_inline(second, 32);
+    my_assert(mem_alloc_inline(20) == second);
+
+    // Full lists drain back to the pool; blocks may also go back with mem_free
+    void *blocks[1000];
+    for (int i = 0; i < 1000; i++)
+    {
+        blocks[i] = mem_alloc_inline(64);
+    }
+    for (int i = 0; i < 1000; i++)
+    {
+        mem_free_inline(blocks[i], 64);
+    }
+    my_assert(mem_inline_cache.lists[mem_size_class(64)].count <= MEM_INLINE_LIMIT(mem_size_class(64)));
+    mem_free(first);
+    mem_free_inline(second, 32);
+    void *large = mem_alloc_inline(MEM_SIZE_CLASS_MAX + 1);
+    my_assert(mem_usable_size(large) == MEM_SIZE_CLASS_MAX + 1);
+    mem_free_inline(large, MEM_SIZE_CLASS_MAX + 1);
+    mem_inline_flush();
+    MemStats stats;
+    mem_get_stats(&stats);
+    my_assert(stats.used_blocks == 0);
+
+    // Threads return their lists when they exit
+    pthread_t threads[4];
+    for (int i = 0; i < 4; i++)
+    {
+        pthread_create(&threads[i], NULL, inline_worker, NULL);
+    }
+    for (int i = 0; i < 4; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    mem_get_stats(&stats);
+    my_assert(stats.used_blocks == 0);
+
+    // Lists left over from a previous pool are not used
+    my_assert(mem_alloc_inline(48) != NULL);
+    mem_deinit();
+    mem_init(4096);
+    void *fresh = mem_alloc_inline(48);
+    my_assert(fresh == mem_pool_base());
+    mem_free_inline(fresh, 48);
+    mem_inline_flush();
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
+
+void test_handles_and_compaction()
+{
+    printf_yellow("  Testing relocatable handles and compaction ---> ");
+    // The fragmentation of test_non_contiguous_allocation_failure, with handles
+    mem_init(800);
+    MemHandle block1 = mem_handle_alloc(250);
+    MemHandle block2 = mem_handle_alloc(250);
+    MemHandle block3 = mem_handle_alloc(250);
+    memset(mem_handle_lock(block2), 0x5A, 250);
+    mem_handle_unlock(block2);
+    mem_handle_free(block1);
+    mem_handle_free(block3);
+
+    // Compaction moves block2 down to the start of the pool, then the allocation fits
+    MemHandle block4 = mem_handle_alloc(500);
+    my_assert(block4 != MEM_HANDLE_NULL);
+    unsigned char *data = mem_handle_lock(block2);
+    my_assert(data == mem_pool_base() && all_value(data, 0x5A, 250));
+    mem_handle_unlock(block2);
+    my_assert(mem_handle_lock(block4) == (char *)mem_pool_base() + 250);
+    mem_handle_unlock(block4);
+    mem_handle_free(block4);
+    mem_handle_free(block2);
+    mem_handle_free(block2);
+    my_assert(mem_handle_lock(MEM_HANDLE_NULL) == NULL);
+    mem_deinit();
+
+    // Locked handles and plain blocks stay put; compaction is bounded by its budget
+    mem_init(1000);
+    MemHandle handles[10];
+    for (int i = 0; i < 10; i++)
+    {
+        handles[i] = mem_handle_alloc(100);
+        memset(mem_handle_lock(handles[i]), i, 100);
+        mem_handle_unlock(handles[i]);
+    }
+    for (int i = 0; i < 10; i += 2)
+    {
+        mem_handle_free(handles[i]);
+    }
+    void *pinned = mem_handle_lock(handles[5]);
+    my_assert(mem_compact(1) == 100);
+    my_assert(mem_handle_lock(handles[1]) == mem_pool_base());
+    mem_handle_unlock(handles[1]);
+    my_assert(mem_compact(SIZE_MAX) == 300);
+    my_assert(mem_compact(SIZE_MAX) == 0);
+    my_assert(mem_handle_lock(handles[5]) == pinned);
+    mem_handle_unlock(handles[5]);
+    mem_handle_unlock(handles[5]);
+    my_assert(mem_compact(SIZE_MAX) > 0);
+    for (int i = 1; i < 10; i += 2)
+    {
+        unsigned char *block = mem_handle_lock(handles[i]);
+        my_assert(block == (unsigned char *)mem_pool_base() + 100 * (i / 2) && all_value(block, i, 100));
+        mem_handle_unlock(handles[i]);
+    }
+    // Last block first, so each free merges with the free space behind it
+    for (int i = 9; i > 0; i -= 2)
+    {
+        mem_handle_free(handles[i]);
+    }
+    MemStats stats;
+    mem_get_stats(&stats);
+    my_assert(stats.free_blocks == 1 && stats.used_blocks == 0);
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
+
+static void *pressure_reserve = NULL;
+static int pressure_calls = 0;
+
+// Pressure handler that gives up a reserve block once
+static bool release_reserve(size_t size, void *arg)
+{
+    (void)size;
+    pressure_calls++;
+    if (!pressure_reserve)
+    {
+        return false;
+    }
+    mem_free(pressure_reserve);
+    pressure_reserve = NULL;
+    return arg == &pressure_reserve;
+}
+
+// Pressure handler that never frees anything but always asks for a retry
+static bool claim_progress(size_t size, void *arg)
+{
+    (void)size;
+    (void)arg;
+    pressure_calls++;
+    return true;
+}
+
+static int swap_tag_a = 0;
+static int swap_tag_b = 0;
+static atomic_int swap_calls = 0;
+static atomic_int swap_mismatches = 0;
+
+// Pressure handlers that check they were installed with their own tag
+static bool swap_handler_a(size_t size, void *arg)
+{
+    (void)size;
+    atomic_fetch_add(&swap_calls, 1);
+    if (arg != &swap_tag_a)
+    {
+        atomic_fetch_add(&swap_mismatches, 1);
+    }
+    return false;
+}
+
+static bool swap_handler_b(size_t size, void *arg)
+{
+    (void)size;
+    atomic_fetch_add(&swap_calls, 1);
+    if (arg != &swap_tag_b)
+    {
+        atomic_fetch_add(&swap_mismatches, 1);
+    }
+    return false;
+}
+
+// Keeps making allocations that fail, each of which calls the pressure handler
+static void *swap_allocator(void *arg)
+{
+    atomic_int *stop = arg;
+    while (!atomic_load(stop))
+    {
+        my_assert(mem_alloc(1 << 20) == NULL);
+    }
+    return NULL;
+}
+
+void test_largest_free_and_pressure()
+{
+    printf_yellow("  Testing largest free block tracking and pressure handlers ---> ");
+    // Five holes of 100 bytes: anything larger is turned away under every policy
+    MemPolicy policies[] = {MEM_FIRST_FIT, MEM_NEXT_FIT, MEM_BEST_FIT, MEM_WORST_FIT};
+    for (int p = 0; p < 4; p++)
+    {
+        mem_set_policy(policies[p]);
+        mem_init(1000);
+        void *blocks[10];
+        for (int i = 0; i < 10; i++)
+        {
+            blocks[i] = mem_alloc(100);
+        }
+        my_assert(mem_alloc(1) == NULL);
+        for (int i = 0; i < 10; i += 2)
+        {
+            mem_free(blocks[i]);
+        }
+        my_assert(mem_alloc(101) == NULL && mem_alloc(5000) == NULL);
+        void *hole = mem_alloc(100);
+        my_assert(hole != NULL);
+        my_assert(mem_alloc_aligned(64, 101) == NULL);
+        mem_free(hole);
+        // Freeing blocks[1] merges it with the hole after it into a 200-byte block
+        mem_free(blocks[1]);
+        my_assert(mem_alloc(200) == blocks[1]);
+        mem_deinit();
+    }
+    mem_set_policy(MEM_FIRST_FIT);
+
+    // The handler frees the reserve and the allocation is retried
+    mem_init(1000);
+    mem_set_pressure_handler(release_reserve, &pressure_reserve);
+    pressure_reserve = mem_alloc(600);
+    void *rest = mem_alloc(300);
+    my_assert(mem_alloc(500) == mem_pool_base() && pressure_calls == 1);
+    // Without progress the handler is asked once and the allocation fails
+    my_assert(mem_alloc(2000) == NULL && pressure_calls == 2);
+    // A handler that keeps claiming progress is called a bounded number of times
+    mem_set_pressure_handler(claim_progress, NULL);
+    my_assert(mem_calloc(1, 2000) == NULL && pressure_calls == 5);
+    mem_free(rest);
+    mem_deinit();
+
+    // mem_pressure_trim compacts handles out of the way
+    mem_init(800);
+    mem_set_pressure_handler(mem_pressure_trim, NULL);
+    MemHandle block1 = mem_handle_alloc(250);
+    MemHandle block2 = mem_handle_alloc(250);
+    MemHandle block3 = mem_handle_alloc(250);
+    mem_handle_free(block1);
+    mem_handle_free(block3);
+    void *big = mem_alloc(500);
+    my_assert(big == (char *)mem_pool_base() + 250);
+    mem_free(big);
+    mem_handle_free(block2);
+    mem_deinit();
+
+    // ... and returns blocks held in the calling thread's magazines
+    mem_init(MEM_SIZE_CLASS_MAX_ROUNDS * 64);
+    void *small = mem_cache_alloc(64);
+    my_assert(small != NULL);
+    mem_set_pressure_handler(NULL, NULL);
+    my_assert(mem_alloc(1024) == NULL);
+    mem_set_pressure_handler(mem_pressure_trim, NULL);
+    void *large = mem_alloc(1024);
+    my_assert(large != NULL);
+    mem_free(large);
+    mem_cache_free(small, 64);
+    mem_cache_flush();
+    mem_set_pressure_handler(NULL, NULL);
+    mem_deinit();
+
+    // Handlers swapped while another thread allocates are always called with their own arg
+    mem_init(1000);
+    atomic_int stop = 0;
+    pthread_t allocators[4];
+    for (int t = 0; t < 4; t++)
+    {
+        my_assert(pthread_create(&allocators[t], NULL, swap_allocator, &stop) == 0);
+    }
+    for (int i = 0; i < 2000000 || atomic_load(&swap_calls) == 0; i++)
+    {
+        if (i % 2)
+        {
+            mem_set_pressure_handler(swap_handler_a, &swap_tag_a);
+        }
+        else
+        {
+            mem_set_pressure_handler(swap_handler_b, &swap_tag_b);
+        }
+    }
+    atomic_store(&stop, 1);
+    for (int t = 0; t < 4; t++)
+    {
+        pthread_join(allocators[t], NULL);
+    }
+    my_assert(atomic_load(&swap_mismatches) == 0);
+    mem_set_pressure_handler(NULL, NULL);
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
+
+void test_file_pool()
+{
+    printf_yellow("  Testing persistent pool files ---> ");
+    char path[] = "/tmp/test_memory_manager_pool_XXXXXX";
+    int fd = mkstemp(path);
+    my_assert(fd >= 0);
+    close(fd);
+
+    // An empty file is laid out as a new pool
+    my_assert(mem_init_file(path, 4096) == 0);
+    char *scratch = mem_alloc(100);
+    char *kept = mem_alloc(200);
+    my_assert(scratch != NULL && kept != NULL);
+    strcpy(kept, "survives the restart");
+    mem_free(scratch);
+    mem_set_root(0, kept);
+    mem_set_root(1, NULL);
+    mem_set_root(MEM_ROOTS, kept);
+    mem_deinit();
+
+    // Mapping it again finds the block, its contents and the free space
+    my_assert(mem_init_file(path, 0) == 1);
+    kept = mem_root(0);
+    my_assert(kept != NULL && strcmp(kept, "survives the restart") == 0);
+    my_assert(mem_root(1) == NULL && mem_root(MEM_ROOTS) == NULL);
+    my_assert(mem_usable_size(kept) == 200);
+    MemStats stats;
+    mem_get_stats(&stats);
+    my_assert(stats.used_blocks == 1 && stats.used_bytes == 200 && stats.free_bytes == 4096 - 200);
+    my_assert(mem_alloc(100) == mem_pool_base());
+    my_assert(mem_alloc(4096) == NULL);
+    mem_deinit();
+    my_assert(mem_root(0) == NULL);
+
+    // A file is busy while a live process has it open, and recovered once it is killed
+    int ready[2];
+    my_assert(pipe(ready) == 0);
+    pid_t child = fork();
+    if (child == 0)
+    {
+        close(ready[0]);
+        if (mem_init_file(path, 0) == 1)
+        {
+            char *message = mem_alloc(100);
+            strcpy(message, "written before the crash");
+            mem_set_root(2, message);
+            write(ready[1], "x", 1);
+        }
+        for (;;)
+        {
+            pause();
+        }
+    }
+    close(ready[1]);
+    char signal_byte;
+    my_assert(read(ready[0], &signal_byte, 1) == 1);
+    close(ready[0]);
+    errno = 0;
+    my_assert(mem_init_file(path, 0) == -1 && errno == EBUSY);
+    kill(child, SIGKILL);
+    int status;
+    my_assert(waitpid(child, &status, 0) == child && WIFSIGNALED(status));
+    my_assert(mem_init_file(path, 0) == 2);
+    char *message = mem_root(2);
+    my_assert(message != NULL && strcmp(message, "written before the crash") == 0);
+    mem_get_stats(&stats);
+    my_assert(stats.used_blocks == 3 && stats.used_bytes == 400 && stats.free_bytes == 4096 - 400);
+    mem_free(message);
+    mem_set_root(2, NULL);
+    mem_deinit();
+    my_assert(mem_init_file(path, 0) == 1);
+    mem_deinit();
+
+    // The block table in the file is fixed: a 64 KiB pool holds 64 * 1024 / 1024 + 64
+    // blocks, so the 128th split fails although memory is left, while an allocation
+    // that takes a whole free block needs no new descriptor
+    my_assert(truncate(path, 0) == 0);
+    my_assert(mem_init_file(path, 64 * 1024) == 0);
+    void *small[128];
+    int count = 0;
+    while (count < 128 && (small[count] = mem_alloc(16)) != NULL)
+    {
+        count++;
+    }
+    my_assert(count == 127);
+    my_assert(mem_alloc(64 * 1024 - 127 * 16) != NULL);
+    mem_free(small[5]);
+    my_assert(mem_alloc(16) == small[5]);
+    mem_deinit();
+
+    // Files that are not pool files are refused
+    FILE *file = fopen(path, "w");
+    fputs("not a pool", file);
+    fclose(file);
+    errno = 0;
+    my_assert(mem_init_file(path, 4096) == -1 && errno == EINVAL);
+    unlink(path);
+    printf_green("[PASS].\n");
+}
+
+// Allocates and frees blocks in a shared pool, checking that none is handed out twice
+static int shared_pool_churn(unsigned char tag)
+{
+    void *blocks[16];
+    for (int round = 0; round < 2000; round++)
+    {
+        for (int i = 0; i < 16; i++)
+        {
+            blocks[i] = mem_alloc(64);
+            if (!blocks[i])
+            {
+                return 1;
+            }
+            memset(blocks[i], tag, 64);
+        }
+        for (int i = 0; i < 16; i++)
+        {
+            if (!all_value(blocks[i], tag, 64))
+            {
+                return 1;
+            }
+            mem_free(blocks[i]);
+        }
+    }
+    return 0;
+}
+
+void test_shared_pool()
+{
+    printf_yellow("  Testing a pool shared between processes ---> ");
+    char name[64];
+    snprintf(name, sizeof(name), "/test_memory_manager_%d", (int)getpid());
+    shm_unlink(name);
+    my_assert(mem_init_shared(name, 64 * 1024) == 0);
+
+    // A block allocated in the child is found and freed by the parent, without copying
+    pid_t child = fork();
+    if (child == 0)
+    {
+        char *message = mem_alloc(100);
+        strcpy(message, "from the child");
+        mem_set_root(0, message);
+        mem_deinit();
+        _exit(0);
+    }
+    int status;
+    my_assert(waitpid(child, &status, 0) == child && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    char *message = mem_root(0);
+    my_assert(message != NULL && strcmp(message, "from the child") == 0);
+    my_assert(mem_from_offset(mem_to_offset(message)) == message);
+    my_assert(mem_to_offset(&status) == SIZE_MAX);
+    mem_set_root(0, NULL);
+    mem_free(message);
+
+    // Both processes allocate at the same time
+    child = fork();
+    if (child == 0)
+    {
+        int failed = shared_pool_churn(0xC1);
+        mem_deinit();
+        _exit(failed);
+    }
+    int failed = shared_pool_churn(0xA1);
+    my_assert(waitpid(child, &status, 0) == child && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    my_assert(failed == 0);
+    MemStats stats;
+    mem_get_stats(&stats);
+    my_assert(stats.used_blocks == 0 && stats.free_bytes == 64 * 1024);
+    mem_deinit();
+
+    // Opening the name again attaches to the existing pool, as the processes left it
+    my_assert(mem_init_shared(name, 0) == 1);
+    MemStats attached;
+    mem_get_stats(&attached);
+    my_assert(attached.free_blocks == stats.free_blocks && attached.free_bytes == 64 * 1024);
+    void *block = mem_alloc(64);
+    my_assert(block != NULL && mem_to_offset(block) != SIZE_MAX);
+    mem_free(block);
+    mem_deinit();
+    shm_unlink(name);
+    errno = 0;
+    my_assert(mem_init_shared(name, 0) == -1 && errno == EINVAL);
+    shm_unlink(name);
+    printf_green("[PASS].\n");
+}
+
+void test_lifetime_hints()
+{
+    printf_yellow("  Testing lifetime hints and short-lived sub-pools ---> ");
+    mem_init(4096);
+    my_assert(mem_grow_hint(4096, MEM_SHORT_LIVED) == 0);
+
+    // Short-lived blocks go to the sub-pool, the long-lived ones between them to pools[0]
+    void *short_lived[8];
+    void *long_lived[8];
+    for (int i = 0; i < 8; i++)
+    {
+        short_lived[i] = mem_alloc_hint(256, MEM_SHORT_LIVED);
+        long_lived[i] = i % 2 ? mem_alloc_hint(64, MEM_LONG_LIVED) : mem_alloc(64);
+        my_assert(short_lived[i] != NULL && mem_to_offset(short_lived[i]) == SIZE_MAX);
+        my_assert(long_lived[i] != NULL && mem_to_offset(long_lived[i]) == (size_t)i * 64);
+    }
+
+    // Once the short-lived blocks are freed the sub-pool is a single free block again
+    for (int i = 0; i < 8; i++)
+    {
+        mem_free(short_lived[i]);
+    }
+    MemStats stats;
+    mem_get_stats(&stats);
+    my_assert(stats.free_blocks == 2 && stats.largest_free == 4096);
+    my_assert(stats.free_bytes == 4096 + 4096 - 8 * 64);
+
+    // Requests without the hint never use the sub-pool
+    my_assert(mem_alloc(4000) == NULL);
+    my_assert(mem_calloc(1, 4000) == NULL);
+    my_assert(mem_alloc_aligned(64, 4000) == NULL);
+
+    // Short-lived requests fall back to the general pools when the sub-pool is full
+    void *whole = mem_alloc_hint(4096, MEM_SHORT_LIVED);
+    my_assert(whole != NULL && mem_to_offset(whole) == SIZE_MAX);
+    void *spilled = mem_alloc_hint(100, MEM_SHORT_LIVED);
+    my_assert(spilled != NULL && mem_to_offset(spilled) == 8 * 64);
+    mem_free(spilled);
+    mem_free(whole);
+    for (int i = 0; i < 8; i++)
+    {
+        mem_free(long_lived[i]);
+    }
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
+
 int main(int argc, char *argv[])
 {
 #ifdef VERSION
@@ -362,7 +1568,46 @@ int main(int argc, char *argv[])
 	
 	printf("\nVarious tests: \n");
 	printf(" 17. test_zero_alloc_and_free - Ensure that we can allocate 0 bytes, and it does not fail.\n");
-	printf(" 18. test_random_blocks - Test that we can allocate a random size, and random amounts of blocks [1000,10000]. \n\n");
+	printf(" 18. test_random_blocks - Test that we can allocate a random size, and random amounts of blocks [1000,10000]. \n");
+	printf(" 19. test_alloc_many_and_free_many - Test the batched allocation and free functions\n");
+	printf(" 20. test_cache_alloc_and_free - Test the thread-local magazine caches\n");
+
+        printf("\nConcurrency:\n");
+        printf(" 21. test_retire_and_reclaim - Test deferred reclamation with mem_retire\n");
+        printf(" 22. test_retire_with_reader - Test that a reader in a critical section delays reclamation\n");
+        printf(" 23. test_cache_threads - Test magazine caches from several threads\n");
+
+        printf("\nNUMA:\n");
+        printf(" 24. test_numa_pools - Test NUMA pools on the machine's topology\n");
+        printf(" 25. test_numa_fake_nodes - Test node-local allocation on a fake two-node topology\n");
+
+        printf("\nAllocation API:\n");
+        printf(" 26. test_grow_and_aligned - Test growing the pool and aligned allocation\n");
+        printf(" 27. test_calloc - Test zeroed allocation with and without known-zero memory\n");
+
+        printf("\nPlacement:\n");
+        printf(" 28. test_placement_policies - Test the first, next, best and worst fit policies\n");
+        printf(" 29. test_block_table - Test growing and recycling the block descriptor table\n");
+
+        printf("\nBitmap pools and size classes:\n");
+        printf(" 30. test_bitmap_pool - Test allocation from a bitmap pool\n");
+        printf(" 31. test_size_classes - Test the generated size class tables and class allocation\n");
+
+        printf("\nInline fast path:\n");
+        printf(" 32. test_inline_fast_path - Test the inline thread-local allocation fast path\n");
+
+        printf("\nHandles:\n");
+        printf(" 33. test_handles_and_compaction - Test relocatable handles and compaction\n");
+
+        printf("\nMemory pressure:\n");
+        printf(" 34. test_largest_free_and_pressure - Test rejecting oversized requests and pressure handlers\n");
+
+        printf("\nPersistent and shared pools:\n");
+        printf(" 35. test_file_pool - Test restoring a pool from its file\n");
+        printf(" 36. test_shared_pool - Test a pool shared between forked processes\n");
+
+        printf("\nLifetime hints:\n");
+        printf(" 37. test_lifetime_hints - Test routing short-lived allocations to sub-pools\n\n");
         printf(" 0. Run all tests\n");
         return 1;
     }
@@ -399,6 +1644,45 @@ int main(int argc, char *argv[])
         printf("\nVarious other tests:\n");
         test_zero_alloc_and_free();
         test_random_blocks();
+        test_alloc_many_and_free_many();
+        test_cache_alloc_and_free();
+
+        printf("\nTesting Concurrency:\n");
+        test_retire_and_reclaim();
+        test_retire_with_reader();
+        test_cache_threads();
+
+        printf("\nTesting NUMA:\n");
+        test_numa_pools();
+        test_numa_fake_nodes();
+
+        printf("\nTesting Allocation API:\n");
+        test_grow_and_aligned();
+        test_calloc();
+
+        printf("\nTesting Placement:\n");
+        test_placement_policies();
+        test_block_table();
+
+        printf("\nTesting Bitmap pools and size classes:\n");
+        test_bitmap_pool();
+        test_size_classes();
+
+        printf("\nTesting Inline fast path:\n");
+        test_inline_fast_path();
+
+        printf("\nTesting Handles:\n");
+        test_handles_and_compaction();
+
+        printf("\nTesting Memory pressure:\n");
+        test_largest_free_and_pressure();
+
+        printf("\nTesting Persistent and shared pools:\n");
+        test_file_pool();
+        test_shared_pool();
+
+        printf("\nTesting Lifetime hints:\n");
+        test_lifetime_hints();
         break;
     case 1:
         test_init();
@@ -454,6 +1738,63 @@ int main(int argc, char *argv[])
     case 18:
         test_random_blocks();
         break;
+    case 19:
+        test_alloc_many_and_free_many();
+        break;
+    case 20:
+        test_cache_alloc_and_free();
+        break;
+    case 21:
+        test_retire_and_reclaim();
+        break;
+    case 22:
+        test_retire_with_reader();
+        break;
+    case 23:
+        test_cache_threads();
+        break;
+    case 24:
+        test_numa_pools();
+        break;
+    case 25:
+        test_numa_fake_nodes();
+        break;
+    case 26:
+        test_grow_and_aligned();
+        break;
+    case 27:
+        test_calloc();
+        break;
+    case 28:
+        test_placement_policies();
+        break;
+    case 29:
+        test_block_table();
+        break;
+    case 30:
+        test_bitmap_pool();
+        break;
+    case 31:
+        test_size_classes();
+        break;
+    case 32:
+        test_inline_fast_path();
+        break;
+    case 33:
+        test_handles_and_compaction();
+        break;
+    case 34:
+        test_largest_free_and_pressure();
+        break;
+    case 35:
+        test_file_pool();
+        break;
+    case 36:
+        test_shared_pool();
+        break;
+    case 37:
+        test_lifetime_hints();
+        break;
     default:
         printf("Invalid test function\n");
         break;
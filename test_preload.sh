@@ -0,0 +1,61 @@
+#!/bin/sh
+# Runs real programs with libmemory_manager_preload.so in LD_PRELOAD and compares their
+# output with a run on the C library's malloc.
+# Usage: ./test_preload.sh [path to libmemory_manager_preload.so]
+
+SHIM=$(realpath "${1:-./libmemory_manager_preload.so}")
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+FAILED=0
+
+pass() { printf '\033[32m[PASS].\033[0m\n'; }
+fail() { printf '\033[31m[FAIL] %s\033[0m\n' "$1"; FAILED=1; }
+testing() { printf '\033[33m  Testing %s ---> \033[0m' "$1"; }
+
+seq 1 200000 | awk 'BEGIN { srand(12345) } { print int(rand() * 1000000) }' > "$WORK/numbers"
+
+testing "sort under the shim"
+sort -n "$WORK/numbers" > "$WORK/expected"
+if LD_PRELOAD="$SHIM" sort -n "$WORK/numbers" > "$WORK/actual" && cmp -s "$WORK/expected" "$WORK/actual"; then
+    pass
+else
+    fail "sort output differs"
+fi
+
+testing "gzip round trip under the shim"
+if LD_PRELOAD="$SHIM" gzip -9 -c "$WORK/numbers" > "$WORK/numbers.gz" &&
+    LD_PRELOAD="$SHIM" gzip -d -c "$WORK/numbers.gz" > "$WORK/actual" && cmp -s "$WORK/numbers" "$WORK/actual"; then
+    pass
+else
+    fail "gzip round trip differs"
+fi
+
+testing "a Python script under the shim"
+cat > "$WORK/script.py" <<'EOF'
+import ctypes, json
+libc = ctypes.CDLL(None)
+libc.malloc.restype = ctypes.c_void_p
+# Only true when malloc comes from the shim
+mem_owns = getattr(libc, "mem_owns", None)
+if mem_owns:
+    mem_owns.restype = ctypes.c_bool
+    mem_owns.argtypes = [ctypes.c_void_p]
+print(bool(mem_owns and mem_owns(libc.malloc(100))))
+table = {str(i): [i] * (i % 7) for i in range(100000)}
+text = json.dumps(table)
+print(len(text), sum(len(v) for v in json.loads(text).values()))
+EOF
+if PYTHON=$(command -v python3); then
+    LD_PRELOAD="$SHIM" "$PYTHON" "$WORK/script.py" > "$WORK/actual"
+    printf 'True\n' > "$WORK/expected"
+    "$PYTHON" "$WORK/script.py" | tail -n 1 >> "$WORK/expected"
+    if cmp -s "$WORK/expected" "$WORK/actual"; then
+        pass
+    else
+        fail "python output differs"
+    fi
+else
+    printf 'skipped (no python3)\n'
+fi
+
+exit $FAILED